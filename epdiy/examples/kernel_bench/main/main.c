@@ -0,0 +1,395 @@
+/*
+ * Microbenchmarks of the line kernels of the render path:
+ * the lookup table kernels converting framebuffer lines to display output,
+ * and the interlacing of two framebuffer lines for difference updates.
+ *
+ * For each kernel, the time per display line and the CPU cycles per pixel are
+ * printed, together with the share of the time one line takes on the display bus.
+ * Kernels with a vector variant are cross-checked against their scalar equivalent.
+ *
+ * Runs without a display, on the device and in the host build (see epdiy/host).
+ */
+
+#include <assert.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epdiy.h>
+
+#include "epd_display.h"
+#include "epd_internals.h"
+#include "output_common/lut.h"
+#include "output_common/render_method.h"
+#include "sdkconfig.h"
+
+// Display to take the line length and bus timing from.
+#define BENCH_DISPLAY ED097TC2
+// Number of distinct framebuffer lines, cycled through by the kernels.
+#define BENCH_LINES 16
+// Number of passes over all lines per measurement.
+#define BENCH_PASSES 64
+// Temperature to select the waveform range with.
+#define BENCH_TEMPERATURE 25
+
+static const char* TAG = "kernel_bench";
+
+int waveform_temp_range_index(const EpdWaveform* waveform, int temperature);
+bool _epd_interlace_line(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int fb_width
+);
+
+#ifdef RENDER_METHOD_LCD
+void calc_epd_input_1ppB_1k_S3_VE(
+    const uint32_t* ld, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
+);
+uint32_t epd_interlace_4bpp_line_VE(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int fb_width
+);
+#endif
+
+/// Framebuffer lines in all input formats of the kernels, and the output line.
+typedef struct {
+    int width;
+    /// goal image, 2 pixels per byte
+    uint8_t* to;
+    /// previous image, 2 pixels per byte
+    uint8_t* from;
+    /// `to` and `from` interlaced, 1 pixel per byte
+    uint8_t* interlaced;
+    /// `to` thresholded to black and white, 8 pixels per byte
+    uint8_t* monochrome;
+    uint8_t* col_dirtyness;
+    uint8_t* lut;
+    uint8_t* output;
+    uint8_t* reference;
+} BenchBuffers;
+
+static int failures = 0;
+
+static uint32_t random_state = 0x12345678;
+
+/// xorshift, for reproducible image noise
+static uint32_t next_random() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+/**
+ * Scalar interlacing of a line, as reference for the optimized variants.
+ */
+static void interlace_line_scalar(
+    const uint8_t* to, const uint8_t* from, uint8_t* interlaced, uint8_t* col_dirtyness, int width
+) {
+    for (int x = 0; x < width; x++) {
+        uint8_t t = (x % 2) ? (to[x / 2] >> 4) : (to[x / 2] & 0x0F);
+        uint8_t f = (x % 2) ? (from[x / 2] >> 4) : (from[x / 2] & 0x0F);
+        col_dirtyness[x / 2] |= (t ^ f) << (4 * (x % 2));
+        interlaced[x] = (t << 4) | f;
+    }
+}
+
+static uint8_t gray_at(int x, int y, int width, int shift) {
+    int value = ((x + shift) % width) * 16 / width + (y % 4) - 2 + (int)(next_random() % 3) - 1;
+    return value < 0 ? 0 : (value > 15 ? 15 : value);
+}
+
+/**
+ * Fill the framebuffer lines with photo-like gray content:
+ * a noisy horizontal gradient, updated to a shifted gradient.
+ * The leftmost quarter of each line is unchanged, like static content.
+ */
+static void fill_gray_lines(BenchBuffers* bufs) {
+    int width = bufs->width;
+    for (int y = 0; y < BENCH_LINES; y++) {
+        uint8_t* to = bufs->to + y * width / 2;
+        uint8_t* from = bufs->from + y * width / 2;
+        uint8_t* monochrome = bufs->monochrome + y * width / 8;
+        memset(monochrome, 0, width / 8);
+        for (int x = 0; x < width; x += 2) {
+            uint8_t t0 = gray_at(x, y, width, width / 3);
+            uint8_t t1 = gray_at(x + 1, y, width, width / 3);
+            uint8_t f0 = gray_at(x, y, width, 0);
+            uint8_t f1 = gray_at(x + 1, y, width, 0);
+            to[x / 2] = t0 | (t1 << 4);
+            from[x / 2] = x < width / 4 ? to[x / 2] : f0 | (f1 << 4);
+            monochrome[x / 8] |= ((t0 >= 8) << (x % 8)) | ((t1 >= 8) << (x % 8 + 1));
+        }
+        interlace_line_scalar(to, from, bufs->interlaced + y * width, bufs->col_dirtyness, width);
+    }
+}
+
+static void bench_buffers_init(BenchBuffers* bufs, int width) {
+    uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    bufs->width = width;
+    bufs->to = heap_caps_aligned_alloc(16, BENCH_LINES * width / 2, caps);
+    bufs->from = heap_caps_aligned_alloc(16, BENCH_LINES * width / 2, caps);
+    bufs->interlaced = heap_caps_aligned_alloc(16, BENCH_LINES * width, caps);
+    bufs->monochrome = heap_caps_aligned_alloc(16, BENCH_LINES * width / 8, caps);
+    bufs->col_dirtyness = heap_caps_aligned_alloc(16, width / 2, caps);
+    bufs->lut = heap_caps_aligned_alloc(16, 1 << 16, caps);
+    bufs->output = heap_caps_aligned_alloc(16, width, caps);
+    bufs->reference = heap_caps_aligned_alloc(16, width, caps);
+    if (bufs->to == NULL || bufs->from == NULL || bufs->interlaced == NULL
+        || bufs->monochrome == NULL || bufs->col_dirtyness == NULL || bufs->lut == NULL
+        || bufs->output == NULL || bufs->reference == NULL) {
+        ESP_LOGE(TAG, "failed to allocate the benchmark buffers");
+        abort();
+    }
+    memset(bufs->col_dirtyness, 0, width / 2);
+    fill_gray_lines(bufs);
+}
+
+static void bench_buffers_free(BenchBuffers* bufs) {
+    heap_caps_free(bufs->to);
+    heap_caps_free(bufs->from);
+    heap_caps_free(bufs->interlaced);
+    heap_caps_free(bufs->monochrome);
+    heap_caps_free(bufs->col_dirtyness);
+    heap_caps_free(bufs->lut);
+    heap_caps_free(bufs->output);
+    heap_caps_free(bufs->reference);
+}
+
+/**
+ * Time it takes to clock out one line on the display bus, in ns.
+ * Porches and line clock overhead are not included.
+ */
+static double line_time_ns(const EpdDisplay_t* display) {
+    int bus_cycles = display->width / 4 / (display->bus_width / 8);
+    return bus_cycles * 1000.0 / display->bus_speed;
+}
+
+static void print_result(const char* name, int64_t time_us, int width, double line_ns) {
+    double ns_per_line = time_us * 1000.0 / (BENCH_PASSES * BENCH_LINES);
+    double cycles_per_px = ns_per_line * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / 1000.0 / width;
+    printf(
+        "%-28s %9.0f ns/line %6.2f cycles/px %6.1f%% of line time\n",
+        name,
+        ns_per_line,
+        cycles_per_px,
+        100.0 * ns_per_line / line_ns
+    );
+}
+
+/**
+ * Build the lookup table of `mode` for the current waveform frame
+ * and run its lookup function over all lines, with lines of `in_bytes` bytes as input.
+ * Returns the lookup function, and leaves the output of the last line in `bufs->output`.
+ */
+static lut_func_t bench_lookup(
+    BenchBuffers* bufs,
+    const char* name,
+    enum EpdDrawMode mode,
+    uint32_t lut_size,
+    const EpdWaveformPhases* phases,
+    const uint8_t* input,
+    int in_bytes,
+    double line_ns
+) {
+    LutFunctionPair funcs = find_lut_functions(mode, lut_size);
+    if (funcs.build_func == NULL || funcs.lookup_func == NULL) {
+        printf("%-28s not available\n", name);
+        return NULL;
+    }
+    funcs.build_func(bufs->lut, phases, phases->phases / 2);
+
+    int width = bufs->width;
+    int64_t start = esp_timer_get_time();
+    for (int p = 0; p < BENCH_PASSES; p++) {
+        for (int l = 0; l < BENCH_LINES; l++) {
+            funcs.lookup_func(
+                (const uint32_t*)(input + l * in_bytes), bufs->output, bufs->lut, width
+            );
+        }
+    }
+    int64_t end = esp_timer_get_time();
+    print_result(name, end - start, width, line_ns);
+    return funcs.lookup_func;
+}
+
+/**
+ * Compare the output of a kernel to the output of its scalar equivalent,
+ * and count the kernel as failed if they differ.
+ */
+static void cross_check(const char* name, const uint8_t* out, const uint8_t* reference, int len) {
+    for (int i = 0; i < len; i++) {
+        if (out[i] != reference[i]) {
+            printf(
+                "%s: MISMATCH at byte %d: 0x%02X, expected 0x%02X\n", name, i, out[i], reference[i]
+            );
+            failures++;
+            return;
+        }
+    }
+}
+
+typedef void (*interlace_func_t)(
+    const uint8_t* to, const uint8_t* from, uint8_t* interlaced, uint8_t* col_dirtyness, int width
+);
+
+static void interlace_line(
+    const uint8_t* to, const uint8_t* from, uint8_t* interlaced, uint8_t* col_dirtyness, int width
+) {
+    _epd_interlace_line(to, from, interlaced, col_dirtyness, width);
+}
+
+#ifdef RENDER_METHOD_LCD
+/**
+ * The vector interlacing on aligned buffers, without the alignment handling of
+ * `_epd_interlace_line()`. It covers multiples of 32 pixels, the rest is interlaced in C.
+ */
+static void interlace_line_VE(
+    const uint8_t* to, const uint8_t* from, uint8_t* interlaced, uint8_t* col_dirtyness, int width
+) {
+    int vector_width = width / 32 * 32;
+    epd_interlace_4bpp_line_VE(to, from, interlaced, col_dirtyness, vector_width);
+    interlace_line_scalar(
+        to + vector_width / 2,
+        from + vector_width / 2,
+        interlaced + vector_width,
+        col_dirtyness + vector_width / 2,
+        width - vector_width
+    );
+}
+#endif
+
+/**
+ * Run an interlacing function over all lines and cross-check the last line
+ * and the column dirtyness against the scalar interlacing.
+ */
+static void bench_interlace(
+    BenchBuffers* bufs, const char* name, interlace_func_t func, double line_ns
+) {
+    int width = bufs->width;
+    memset(bufs->col_dirtyness, 0, width / 2);
+    int64_t start = esp_timer_get_time();
+    for (int p = 0; p < BENCH_PASSES; p++) {
+        for (int l = 0; l < BENCH_LINES; l++) {
+            func(
+                bufs->to + l * width / 2,
+                bufs->from + l * width / 2,
+                bufs->output,
+                bufs->col_dirtyness,
+                width
+            );
+        }
+    }
+    int64_t end = esp_timer_get_time();
+    print_result(name, end - start, width, line_ns);
+
+    uint8_t* reference_dirtyness = calloc(width / 2, 1);
+    assert(reference_dirtyness != NULL);
+    for (int l = 0; l < BENCH_LINES; l++) {
+        interlace_line_scalar(
+            bufs->to + l * width / 2,
+            bufs->from + l * width / 2,
+            bufs->reference,
+            reference_dirtyness,
+            width
+        );
+    }
+    cross_check(name, bufs->output, bufs->reference, width);
+    cross_check(name, bufs->col_dirtyness, reference_dirtyness, width / 2);
+    free(reference_dirtyness);
+}
+
+void app_main() {
+    const EpdDisplay_t* display = &BENCH_DISPLAY;
+    const EpdWaveform* waveform = display->default_waveform;
+    int width = display->width;
+    double line_ns = line_time_ns(display);
+
+    const EpdWaveformPhases* phases = NULL;
+    int range = waveform_temp_range_index(waveform, BENCH_TEMPERATURE);
+    for (int i = 0; i < waveform->num_modes; i++) {
+        if (waveform->mode_data[i]->type == MODE_GC16) {
+            phases = waveform->mode_data[i]->range_data[range];
+        }
+    }
+    assert(phases != NULL);
+
+    BenchBuffers bufs;
+    bench_buffers_init(&bufs, width);
+
+    printf(
+        "%d px lines, %.0f ns per line at %d MHz on the %d bit bus, %d MHz CPU\n",
+        width,
+        line_ns,
+        display->bus_speed,
+        display->bus_width,
+        CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+    );
+
+    enum EpdDrawMode diff_mode = MODE_GC16 | MODE_PACKING_1PPB_DIFFERENCE;
+    bench_lookup(
+        &bufs,
+        "1ppB, 64k LUT",
+        diff_mode | MODE_FORCE_NO_PIE,
+        1 << 16,
+        phases,
+        bufs.interlaced,
+        width,
+        line_ns
+    );
+    memcpy(bufs.reference, bufs.output, width / 4);
+#ifdef RENDER_METHOD_LCD
+    lut_func_t vector_lookup = bench_lookup(
+        &bufs, "1ppB, 1k LUT, vector", diff_mode, 1 << 10, phases, bufs.interlaced, width, line_ns
+    );
+    if (vector_lookup == calc_epd_input_1ppB_1k_S3_VE) {
+        cross_check("1ppB, 1k LUT, vector", bufs.output, bufs.reference, width / 4);
+    }
+#endif
+
+    enum EpdDrawMode packed_mode = MODE_GC16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE;
+    bench_lookup(
+        &bufs, "2ppB, 64k LUT", packed_mode, 1 << 16, phases, bufs.to, width / 2, line_ns
+    );
+    memcpy(bufs.reference, bufs.output, width / 4);
+    lut_func_t small_lookup = bench_lookup(
+        &bufs, "2ppB, 1k LUT", packed_mode, 1 << 10, phases, bufs.to, width / 2, line_ns
+    );
+    if (small_lookup != NULL) {
+        cross_check("2ppB, 1k LUT", bufs.output, bufs.reference, width / 4);
+    }
+
+    bench_lookup(
+        &bufs,
+        "8ppB",
+        MODE_DU | MODE_PACKING_8PPB | PREVIOUSLY_WHITE,
+        1 << 10,
+        phases,
+        bufs.monochrome,
+        width / 8,
+        line_ns
+    );
+
+    bench_interlace(&bufs, "interlace, scalar", interlace_line_scalar, line_ns);
+    bench_interlace(&bufs, "interlace", interlace_line, line_ns);
+#ifdef RENDER_METHOD_LCD
+    bench_interlace(&bufs, "interlace, vector", interlace_line_VE, line_ns);
+#endif
+
+    bench_buffers_free(&bufs);
+
+    if (failures > 0) {
+        ESP_LOGE(TAG, "%d kernels do not match their scalar equivalent", failures);
+        abort();
+    }
+    ESP_LOGI(TAG, "all kernels match their scalar equivalents");
+}
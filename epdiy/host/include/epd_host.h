@@ -0,0 +1,51 @@
+/**
+ * @file "epd_host.h"
+ * @brief Simulated board and panel of the host build.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "epd_board.h"
+
+/**
+ * Board definition of the host build.
+ * Lines are output to the simulated panel instead of the LCD peripheral.
+ */
+extern const EpdBoardDefinition epd_board_host;
+
+/**
+ * A frame as output to the simulated panel.
+ */
+typedef struct {
+    /// Number of frames output before this one since `epd_init()`.
+    uint32_t index;
+    /// Display width in pixels.
+    int width;
+    /// Number of lines in `data`, the display height rounded up to a multiple of 8.
+    int height;
+    /// Bytes per line, with 2 bits per pixel as output to the data bus.
+    int line_bytes;
+    /// Lines at the top skipped without clocking out data.
+    int lines_skipped;
+    /// Lines clocked out, counted from the top and including the skipped ones.
+    int lines_total;
+    /// Line data of the frame. Lines that were not clocked out are 0.
+    const uint8_t* data;
+} EpdHostFrame;
+
+/// Called after each frame output to the simulated panel.
+typedef void (*epd_host_frame_func_t)(const EpdHostFrame* frame, void* arg);
+
+/**
+ * Set a callback to record the frames output to the simulated panel,
+ * or NULL to disable recording.
+ */
+void epd_host_set_frame_cb(epd_host_frame_func_t cb, void* arg);
+
+/**
+ * Check if the board currently powers the display.
+ */
+bool epd_host_powered();
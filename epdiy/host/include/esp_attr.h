@@ -0,0 +1,7 @@
+#pragma once
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+#define DRAM_ATTR
+#define EXT_RAM_BSS_ATTR
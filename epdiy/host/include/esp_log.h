@@ -0,0 +1,21 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "esp_timer.h"
+
+#define EPD_HOST_LOG(letter, tag, format, ...) \
+    fprintf(                                   \
+        stderr,                                \
+        letter " (%" PRId64 ") %s: " format "\n", \
+        esp_timer_get_time() / 1000,           \
+        tag,                                   \
+        ##__VA_ARGS__                          \
+    )
+
+#define ESP_LOGE(tag, format, ...) EPD_HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) EPD_HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) EPD_HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+#define ESP_LOGV(tag, format, ...) ((void)(tag))
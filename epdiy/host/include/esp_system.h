@@ -0,0 +1,6 @@
+#pragma once
+
+// Included by the I2S render method headers, nothing is used on the host.
+
+#include "esp_err.h"
+#include "esp_idf_version.h"
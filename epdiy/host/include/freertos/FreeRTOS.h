@@ -0,0 +1,44 @@
+#pragma once
+
+// FreeRTOS API subset used by epdiy, implemented with POSIX threads.
+// One tick is one millisecond.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_attr.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+typedef struct HostTask* TaskHandle_t;
+typedef struct HostSemaphore* SemaphoreHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+
+#define portMAX_DELAY ((TickType_t)0xffffffffu)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7fffffff
+
+// Interrupts are simulated by the threads of the host drivers.
+#define portYIELD_FROM_ISR(...)
+
+/// Critical sections only exclude each other, as interrupts are threads.
+typedef struct {
+    pthread_mutex_t lock;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { PTHREAD_MUTEX_INITIALIZER }
+#define taskENTER_CRITICAL(mux) pthread_mutex_lock(&(mux)->lock)
+#define taskEXIT_CRITICAL(mux) pthread_mutex_unlock(&(mux)->lock)
+
+/// Core of the calling task, as it was pinned when created. 0 for other threads.
+BaseType_t xPortGetCoreID(void);
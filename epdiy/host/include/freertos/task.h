@@ -0,0 +1,29 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+
+/// Start a task as thread. Priorities are ignored, the core is only recorded.
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t function,
+    const char* name,
+    uint32_t stack_depth,
+    void* arg,
+    UBaseType_t priority,
+    TaskHandle_t* created,
+    BaseType_t core
+);
+
+#define xTaskCreate(function, name, stack_depth, arg, priority, created) \
+    xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, created, tskNO_AFFINITY)
+
+/// Delete a task. Other tasks exit the next time they wait for a notification or delay.
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken);
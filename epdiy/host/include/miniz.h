@@ -0,0 +1,36 @@
+#pragma once
+
+// The subset of the miniz inflate API used by epdiy, implemented with zlib.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TINFL_FLAG_PARSE_ZLIB_HEADER 1
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+#define TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF 4
+
+typedef enum {
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    int initialized;
+} tinfl_decompressor;
+
+#define tinfl_init(r) ((r)->initialized = 1)
+
+/// Decompress all input at once, only non-wrapping output buffers are supported.
+tinfl_status tinfl_decompress(
+    tinfl_decompressor* r,
+    const uint8_t* in_buf,
+    size_t* in_buf_size,
+    uint8_t* out_buf_start,
+    uint8_t* out_buf_next,
+    size_t* out_buf_size,
+    uint32_t flags
+);
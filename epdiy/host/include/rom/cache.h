@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+// There is no cache to preload on the host.
+static inline void Cache_Start_DCache_Preload(uint32_t addr, uint32_t size, uint32_t order) {
+    (void)addr;
+    (void)size;
+    (void)order;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+// The host build uses the render path of the ESP32-S3,
+// with the LCD peripheral replaced by the simulated panel.
+#define CONFIG_IDF_TARGET_ESP32S3 1
+#define CONFIG_IDF_TARGET "host"
+// CPU clock the cycle counts of the host build are scaled to.
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
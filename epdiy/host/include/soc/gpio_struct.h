@@ -0,0 +1,3 @@
+#pragma once
+
+// Included by the I2S render method headers, nothing is used on the host.
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+// A cycle counter running at the CPU clock of the ESP32.
+#define XTHAL_GET_CCOUNT() ((uint32_t)(esp_timer_get_time() * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ))
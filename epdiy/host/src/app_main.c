@@ -0,0 +1,8 @@
+// Runs an ESP-IDF application of the examples on the host.
+
+void app_main();
+
+int main() {
+    app_main();
+    return 0;
+}
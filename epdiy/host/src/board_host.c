@@ -0,0 +1,75 @@
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "epd_board.h"
+#include "epd_display.h"
+#include "epd_host.h"
+#include "epdiy.h"
+#include "output_lcd/lcd_driver.h"
+
+static bool powered = false;
+static int vcom = 1600;
+
+static void epd_board_init(uint32_t epd_row_width) {
+    (void)epd_row_width;
+    const EpdDisplay_t* display = epd_get_display();
+
+    LcdEpdConfig_t config = {
+        .pixel_clock = display->bus_speed * 1000 * 1000,
+        .ckv_high_time = 60,
+        .line_front_porch = 4,
+        .le_high_time = 4,
+        .bus_width = display->bus_width,
+    };
+    epd_lcd_init(&config, display->width, display->height);
+}
+
+static void epd_board_deinit() {
+    epd_lcd_deinit();
+    powered = false;
+}
+
+static void epd_board_set_ctrl(epd_ctrl_state_t* state, const epd_ctrl_state_t* const mask) {
+    (void)state;
+    (void)mask;
+}
+
+static void epd_board_poweron(epd_ctrl_state_t* state) {
+    state->ep_stv = true;
+    powered = true;
+}
+
+static void epd_board_poweroff(epd_ctrl_state_t* state) {
+    state->ep_stv = false;
+    state->ep_output_enable = false;
+    state->ep_mode = false;
+    powered = false;
+}
+
+static float epd_board_ambient_temperature() {
+    return 25;
+}
+
+static void set_vcom(int value) {
+    vcom = value;
+}
+
+bool epd_host_powered() {
+    return powered;
+}
+
+const EpdBoardDefinition epd_board_host = {
+    .init = epd_board_init,
+    .deinit = epd_board_deinit,
+    .set_ctrl = epd_board_set_ctrl,
+    .poweron = epd_board_poweron,
+    .poweroff = epd_board_poweroff,
+
+    .measure_vcom = NULL,
+    .get_temperature = epd_board_ambient_temperature,
+    .set_vcom = set_vcom,
+
+    .gpio_set_direction = NULL,
+    .gpio_read = NULL,
+    .gpio_write = NULL,
+};
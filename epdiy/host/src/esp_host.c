@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "miniz.h"
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    return calloc(n, size);
+}
+
+void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+    (void)caps;
+    void* ptr = NULL;
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+void* heap_caps_aligned_calloc(size_t alignment, size_t n, size_t size, uint32_t caps) {
+    void* ptr = heap_caps_aligned_alloc(alignment, n * size, caps);
+    if (ptr != NULL) {
+        memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+void heap_caps_free(void* ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    return SIZE_MAX / 2;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    (void)caps;
+    return SIZE_MAX / 2;
+}
+
+int64_t esp_timer_get_time(void) {
+    static int64_t start = -1;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if (start < 0) {
+        start = now;
+    }
+    return now - start;
+}
+
+tinfl_status tinfl_decompress(
+    tinfl_decompressor* r,
+    const uint8_t* in_buf,
+    size_t* in_buf_size,
+    uint8_t* out_buf_start,
+    uint8_t* out_buf_next,
+    size_t* out_buf_size,
+    uint32_t flags
+) {
+    if (r == NULL || !r->initialized || !(flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF)
+        || out_buf_next != out_buf_start) {
+        return TINFL_STATUS_BAD_PARAM;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    int window_bits = (flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? MAX_WBITS : -MAX_WBITS;
+    if (inflateInit2(&stream, window_bits) != Z_OK) {
+        return TINFL_STATUS_FAILED;
+    }
+    stream.next_in = (Bytef*)in_buf;
+    stream.avail_in = *in_buf_size;
+    stream.next_out = out_buf_next;
+    stream.avail_out = *out_buf_size;
+
+    int result = inflate(&stream, Z_FINISH);
+    *in_buf_size = stream.total_in;
+    *out_buf_size = stream.total_out;
+    inflateEnd(&stream);
+
+    if (result == Z_STREAM_END) {
+        return TINFL_STATUS_DONE;
+    } else if (result == Z_BUF_ERROR && stream.avail_out == 0) {
+        return TINFL_STATUS_HAS_MORE_OUTPUT;
+    } else if (result == Z_BUF_ERROR) {
+        return TINFL_STATUS_NEEDS_MORE_INPUT;
+    }
+    return TINFL_STATUS_FAILED;
+}
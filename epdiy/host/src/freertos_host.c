@@ -0,0 +1,273 @@
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+struct HostTask {
+    pthread_t thread;
+    TaskFunction_t function;
+    void* arg;
+    int core;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notifications;
+    /// Set by `vTaskDelete()` from another task, the task exits when it next waits.
+    bool deleted;
+};
+
+struct HostSemaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t given;
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+/// The task running on this thread, created on demand for threads not started as a task.
+static __thread struct HostTask* current_task = NULL;
+
+static struct HostTask* new_task(TaskFunction_t function, void* arg, int core) {
+    struct HostTask* task = calloc(1, sizeof(struct HostTask));
+    if (task == NULL) {
+        abort();
+    }
+    task->function = function;
+    task->arg = arg;
+    task->core = core;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->notified, NULL);
+    return task;
+}
+
+static void free_task(struct HostTask* task) {
+    pthread_mutex_destroy(&task->lock);
+    pthread_cond_destroy(&task->notified);
+    free(task);
+}
+
+/// Absolute deadline for waiting `ticks` milliseconds.
+static struct timespec deadline(TickType_t ticks) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec += 1;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+/// Wait for a condition with the FreeRTOS timeout semantics, return false on timeout.
+static bool wait_ticks(pthread_cond_t* cond, pthread_mutex_t* lock, TickType_t ticks) {
+    if (ticks == 0) {
+        return false;
+    }
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    struct timespec until = deadline(ticks);
+    return pthread_cond_timedwait(cond, lock, &until) != ETIMEDOUT;
+}
+
+static void exit_if_deleted(struct HostTask* task) {
+    if (task->deleted) {
+        pthread_mutex_unlock(&task->lock);
+        current_task = NULL;
+        free_task(task);
+        pthread_exit(NULL);
+    }
+}
+
+static void* task_main(void* arg) {
+    struct HostTask* task = arg;
+    current_task = task;
+    task->function(task->arg);
+    // tasks must not return in FreeRTOS
+    abort();
+    return NULL;
+}
+
+BaseType_t xPortGetCoreID(void) {
+    if (current_task == NULL || current_task->core == tskNO_AFFINITY) {
+        return 0;
+    }
+    return current_task->core;
+}
+
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t function,
+    const char* name,
+    uint32_t stack_depth,
+    void* arg,
+    UBaseType_t priority,
+    TaskHandle_t* created,
+    BaseType_t core
+) {
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+
+    struct HostTask* task = new_task(function, arg, core);
+    if (created != NULL) {
+        *created = task;
+    }
+    if (pthread_create(&task->thread, NULL, task_main, task) != 0) {
+        free_task(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || task == current_task) {
+        task = xTaskGetCurrentTaskHandle();
+        pthread_mutex_lock(&task->lock);
+        task->deleted = true;
+        exit_if_deleted(task);
+    }
+
+    pthread_mutex_lock(&task->lock);
+    task->deleted = true;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct HostTask* task = xTaskGetCurrentTaskHandle();
+    pthread_mutex_lock(&task->lock);
+    exit_if_deleted(task);
+    pthread_mutex_unlock(&task->lock);
+
+    if (ticks == 0) {
+        sched_yield();
+    } else {
+        usleep(ticks * 1000);
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    if (current_task == NULL) {
+        current_task = new_task(NULL, NULL, 0);
+        current_task->thread = pthread_self();
+    }
+    return current_task;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    struct HostTask* task = xTaskGetCurrentTaskHandle();
+
+    pthread_mutex_lock(&task->lock);
+    exit_if_deleted(task);
+    while (task->notifications == 0) {
+        if (!wait_ticks(&task->notified, &task->lock, ticks)) {
+            break;
+        }
+        exit_if_deleted(task);
+    }
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&task->lock);
+    task->notifications += 1;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken) {
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+}
+
+static SemaphoreHandle_t new_semaphore(UBaseType_t max_count, UBaseType_t initial_count) {
+    struct HostSemaphore* semaphore = calloc(1, sizeof(struct HostSemaphore));
+    if (semaphore == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&semaphore->lock, NULL);
+    pthread_cond_init(&semaphore->given, NULL);
+    semaphore->count = initial_count;
+    semaphore->max_count = max_count;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return new_semaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    // Without priority inheritance or owner checks, a mutex is a given binary semaphore.
+    return new_semaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    return new_semaphore(max_count, initial_count);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    if (semaphore == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&semaphore->lock);
+    pthread_cond_destroy(&semaphore->given);
+    free(semaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    pthread_mutex_lock(&semaphore->lock);
+    while (semaphore->count == 0) {
+        if (!wait_ticks(&semaphore->given, &semaphore->lock, ticks)) {
+            break;
+        }
+    }
+    BaseType_t taken = pdFALSE;
+    if (semaphore->count > 0) {
+        semaphore->count -= 1;
+        taken = pdTRUE;
+    }
+    pthread_mutex_unlock(&semaphore->lock);
+    return taken;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    pthread_mutex_lock(&semaphore->lock);
+    BaseType_t given = pdFALSE;
+    if (semaphore->count < semaphore->max_count) {
+        semaphore->count += 1;
+        given = pdTRUE;
+        pthread_cond_signal(&semaphore->given);
+    }
+    pthread_mutex_unlock(&semaphore->lock);
+    return given;
+}
+
+BaseType_t xSemaphoreGiveFromISR(
+    SemaphoreHandle_t semaphore, BaseType_t* higher_priority_task_woken
+) {
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xSemaphoreGive(semaphore);
+}
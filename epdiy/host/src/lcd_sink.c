@@ -0,0 +1,254 @@
+// Simulated LCD peripheral of the host build.
+//
+// Implements the LCD driver interface of output_lcd/lcd_driver.h.
+// Each frame started with `epd_lcd_start_frame()` is clocked out by the panel thread,
+// which fetches the lines from the line source like the bounce buffer refills
+// of the real driver, records them and reports the frame as done.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_timer.h>
+
+#include "epd_host.h"
+#include "output_common/render_context.h"
+#include "output_lcd/lcd_driver.h"
+
+static struct {
+    int display_width;
+    int display_height;
+    int line_bytes;
+    /// Lines of the recorded frame, the display height rounded up to a multiple of 8.
+    int frame_height;
+    int frame_lines;
+    int skipped_lines;
+    bool zero_copy;
+    int pixel_clock_MHz;
+
+    line_cb_func_t line_source_cb;
+    void* line_source_payload;
+    line_slot_func_t line_slot_cb;
+    line_release_func_t line_release_cb;
+    void* line_slot_payload;
+    frame_done_func_t frame_done_cb;
+    void* frame_done_payload;
+
+    epd_host_frame_func_t frame_cb;
+    void* frame_cb_arg;
+
+    uint8_t* frame;
+    LcdEpdStats_t stats;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    bool frame_requested;
+    bool running;
+} panel;
+
+/**
+ * Wait until the next line requested from a render context line source is prepared.
+ *
+ * The real panel does not wait, a line that is not ready is an underrun.
+ * On the host, the render threads may be descheduled at any time,
+ * so the panel waits for them to keep the output independent of scheduling.
+ */
+static void wait_for_line(void* payload) {
+    const RenderContext_t* ctx = payload;
+    while (true) {
+        int line = ctx->lines_consumed;
+        // errors end the frame without line data, push_pixels has no line queues
+        if (ctx->error || ctx->static_line_buffer != NULL || line >= ctx->lines_total) {
+            return;
+        }
+        int thread = ((volatile const uint8_t*)ctx->line_threads)[line];
+        if (thread < ctx->num_threads) {
+            const LineQueue_t* lq = &ctx->line_queues[thread];
+            if (atomic_load(&lq->current) != atomic_load(&lq->last)) {
+                return;
+            }
+        }
+        sched_yield();
+    }
+}
+
+static void output_frame() {
+    pthread_mutex_lock(&panel.lock);
+    line_cb_func_t line_source = panel.line_source_cb;
+    void* line_source_payload = panel.line_source_payload;
+    line_slot_func_t line_slot = panel.zero_copy ? panel.line_slot_cb : NULL;
+    line_release_func_t line_release = panel.line_release_cb;
+    void* line_slot_payload = panel.line_slot_payload;
+    int lines_total = panel.frame_lines;
+    int lines_skipped = panel.skipped_lines;
+    pthread_mutex_unlock(&panel.lock);
+
+    memset(panel.frame, 0, (size_t)panel.frame_height * panel.line_bytes);
+    for (int l = lines_skipped; l < lines_total; l++) {
+        uint8_t* line = panel.frame + (size_t)l * panel.line_bytes;
+        int64_t start_us = -1;
+        if (line_slot != NULL) {
+            wait_for_line(line_slot_payload);
+            start_us = esp_timer_get_time();
+            const uint8_t* slot = line_slot(line_slot_payload);
+            if (slot != NULL) {
+                memcpy(line, slot, panel.line_bytes);
+                line_release(line_slot_payload, slot);
+            }
+        } else if (line_source != NULL) {
+            wait_for_line(line_source_payload);
+            start_us = esp_timer_get_time();
+            line_source(line_source_payload, line);
+        }
+        // like a refill interrupt, without the time spent waiting for the line
+        if (start_us >= 0) {
+            uint32_t refill_us = esp_timer_get_time() - start_us;
+            panel.stats.total_refill_us += refill_us;
+            if (refill_us > panel.stats.max_refill_us) {
+                panel.stats.max_refill_us = refill_us;
+            }
+        }
+        panel.stats.refills++;
+    }
+
+    if (panel.frame_cb != NULL) {
+        EpdHostFrame frame = {
+            .index = panel.stats.frames,
+            .width = panel.display_width,
+            .height = panel.frame_height,
+            .line_bytes = panel.line_bytes,
+            .lines_skipped = lines_skipped,
+            .lines_total = lines_total,
+            .data = panel.frame,
+        };
+        panel.frame_cb(&frame, panel.frame_cb_arg);
+    }
+    panel.stats.frames++;
+
+    pthread_mutex_lock(&panel.lock);
+    frame_done_func_t frame_done = panel.frame_done_cb;
+    void* frame_done_payload = panel.frame_done_payload;
+    pthread_mutex_unlock(&panel.lock);
+    if (frame_done != NULL) {
+        frame_done(frame_done_payload);
+    }
+}
+
+static void* panel_main(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&panel.lock);
+    while (panel.running) {
+        if (!panel.frame_requested) {
+            pthread_cond_wait(&panel.start, &panel.lock);
+            continue;
+        }
+        panel.frame_requested = false;
+        pthread_mutex_unlock(&panel.lock);
+        output_frame();
+        pthread_mutex_lock(&panel.lock);
+    }
+    pthread_mutex_unlock(&panel.lock);
+    return NULL;
+}
+
+void epd_lcd_init(const LcdEpdConfig_t* config, int display_width, int display_height) {
+    panel.display_width = display_width;
+    panel.display_height = display_height;
+    panel.line_bytes = display_width / 4;
+    panel.frame_height = (display_height + 7) / 8 * 8;
+    panel.frame_lines = panel.frame_height;
+    panel.skipped_lines = 0;
+    panel.zero_copy = config->zero_copy;
+    panel.pixel_clock_MHz = config->pixel_clock / 1000 / 1000;
+    memset(&panel.stats, 0, sizeof(LcdEpdStats_t));
+
+    panel.frame = malloc((size_t)panel.frame_height * panel.line_bytes);
+    if (panel.frame == NULL) {
+        abort();
+    }
+
+    pthread_mutex_init(&panel.lock, NULL);
+    pthread_cond_init(&panel.start, NULL);
+    panel.frame_requested = false;
+    panel.running = true;
+    if (pthread_create(&panel.thread, NULL, panel_main, NULL) != 0) {
+        abort();
+    }
+}
+
+void epd_lcd_deinit() {
+    pthread_mutex_lock(&panel.lock);
+    panel.running = false;
+    pthread_cond_signal(&panel.start);
+    pthread_mutex_unlock(&panel.lock);
+    pthread_join(panel.thread, NULL);
+
+    pthread_mutex_destroy(&panel.lock);
+    pthread_cond_destroy(&panel.start);
+    free(panel.frame);
+    panel.frame = NULL;
+}
+
+void epd_lcd_frame_done_cb(frame_done_func_t cb, void* payload) {
+    pthread_mutex_lock(&panel.lock);
+    panel.frame_done_cb = cb;
+    panel.frame_done_payload = payload;
+    pthread_mutex_unlock(&panel.lock);
+}
+
+void epd_lcd_line_source_cb(line_cb_func_t line_source, void* payload) {
+    pthread_mutex_lock(&panel.lock);
+    panel.line_source_cb = line_source;
+    panel.line_source_payload = payload;
+    pthread_mutex_unlock(&panel.lock);
+}
+
+void epd_lcd_line_slot_cb(line_slot_func_t slot, line_release_func_t release, void* payload) {
+    pthread_mutex_lock(&panel.lock);
+    panel.line_slot_cb = slot;
+    panel.line_release_cb = release;
+    panel.line_slot_payload = payload;
+    pthread_mutex_unlock(&panel.lock);
+}
+
+void epd_lcd_start_frame() {
+    pthread_mutex_lock(&panel.lock);
+    panel.frame_requested = true;
+    pthread_cond_signal(&panel.start);
+    pthread_mutex_unlock(&panel.lock);
+}
+
+void epd_lcd_set_frame_lines(int lines) {
+    lines = (lines + 7) / 8 * 8;
+    panel.frame_lines = lines < panel.frame_height ? lines : panel.frame_height;
+}
+
+void epd_lcd_set_skipped_lines(int lines) {
+    lines = lines / 8 * 8;
+    int max_skipped = panel.frame_lines - 8;
+    panel.skipped_lines = lines < max_skipped ? lines : max_skipped;
+    if (panel.skipped_lines < 0) {
+        panel.skipped_lines = 0;
+    }
+}
+
+void epd_lcd_set_pixel_clock_MHz(int frequency) {
+    panel.pixel_clock_MHz = frequency;
+}
+
+void epd_lcd_get_stats(LcdEpdStats_t* stats) {
+    *stats = panel.stats;
+    stats->line_batch = panel.frame_lines;
+}
+
+void epd_lcd_reset_stats() {
+    memset(&panel.stats, 0, sizeof(LcdEpdStats_t));
+}
+
+void epd_host_set_frame_cb(epd_host_frame_func_t cb, void* arg) {
+    panel.frame_cb = cb;
+    panel.frame_cb_arg = arg;
+}
@@ -0,0 +1,62 @@
+// Scalar implementations of the ESP32-S3 vector extension routines
+// in diff.S and output_common/lut.S, with the same results and length requirements.
+
+#include <assert.h>
+#include <stdint.h>
+
+/**
+ * Interlace a line of the goal and previous 4bpp images into one byte per pixel,
+ * with the goal in the upper nibble, and mark the changed columns.
+ * Expects a length in pixels that is divisible by 32.
+ */
+uint32_t epd_interlace_4bpp_line_VE(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int fb_width
+) {
+    // the vector loop count is unsigned, other lengths overrun the buffers on the device
+    assert(fb_width >= 0 && fb_width % 32 == 0);
+    uint32_t dirty = 0;
+    for (int i = 0; i < fb_width / 32 * 16; i++) {
+        uint8_t t = to[i];
+        uint8_t f = from[i];
+        uint8_t diff = t ^ f;
+        col_dirtyness[i] |= diff;
+        dirty |= diff;
+        interlaced[2 * i] = ((t << 4) & 0xF0) | (f & 0x0F);
+        interlaced[2 * i + 1] = (t & 0xF0) | (f >> 4);
+    }
+    return dirty;
+}
+
+/**
+ * Apply an output line mask, for mask lengths divisible by 16 bytes.
+ */
+void epd_apply_line_mask_VE(uint8_t* line, const uint8_t* mask, int mask_len) {
+    assert(mask_len >= 0 && mask_len % 16 == 0);
+    for (int i = 0; i < mask_len / 16 * 16; i++) {
+        line[i] &= mask[i];
+    }
+}
+
+/**
+ * Look up 4 interlaced pixels per output byte in the 1k LUT of 32 bit entries,
+ * with the first pixel in the lowest bits.
+ * Expects a length in pixels that is divisible by 16.
+ */
+void calc_epd_input_1ppB_1k_S3_VE_aligned(
+    const uint32_t* ld, uint8_t* epd_input, const uint8_t* conversion_lut, uint32_t epd_width
+) {
+    assert(epd_width % 16 == 0);
+    const uint32_t* padded_lut = (const uint32_t*)conversion_lut;
+    for (uint32_t i = 0; i < epd_width / 4; i++) {
+        uint32_t in = ld[i];
+        uint8_t out = padded_lut[(in >> 24) & 0xFF] << 6;
+        out |= padded_lut[(in >> 16) & 0xFF] << 4;
+        out |= padded_lut[(in >> 8) & 0xFF] << 2;
+        out |= padded_lut[(in >> 0) & 0xFF];
+        epd_input[i] = out;
+    }
+}
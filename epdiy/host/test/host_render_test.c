@@ -0,0 +1,375 @@
+// Checks the lines output to the simulated panel by the host build.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epd_display.h"
+#include "epd_highlevel.h"
+#include "epd_host.h"
+#include "epdiy.h"
+
+#define CHECK(condition)                                                     \
+    do {                                                                     \
+        if (!(condition)) {                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1);                                                         \
+        }                                                                    \
+    } while (0)
+
+/// Bounds of the driven pixels over all recorded frames, in output bytes and lines.
+typedef struct {
+    int frames;
+    int min_byte;
+    int max_byte;
+    int min_line;
+    int max_line;
+} DrivenBounds;
+
+static void record_bounds(const EpdHostFrame* frame, void* arg) {
+    DrivenBounds* bounds = arg;
+    bounds->frames++;
+    for (int l = 0; l < frame->height; l++) {
+        const uint8_t* line = frame->data + l * frame->line_bytes;
+        for (int b = 0; b < frame->line_bytes; b++) {
+            if (line[b] == 0) {
+                continue;
+            }
+            bounds->min_byte = b < bounds->min_byte ? b : bounds->min_byte;
+            bounds->max_byte = b > bounds->max_byte ? b : bounds->max_byte;
+            bounds->min_line = l < bounds->min_line ? l : bounds->min_line;
+            bounds->max_line = l > bounds->max_line ? l : bounds->max_line;
+        }
+    }
+}
+
+static void reset_bounds(DrivenBounds* bounds) {
+    bounds->frames = 0;
+    bounds->min_byte = bounds->min_line = 1 << 30;
+    bounds->max_byte = bounds->max_line = -1;
+}
+
+/// Only the pixels of `area` are driven, in at least one frame.
+static void check_bounds(const DrivenBounds* bounds, EpdRect area) {
+    CHECK(bounds->frames > 0);
+    CHECK(bounds->min_line == area.y);
+    CHECK(bounds->max_line == area.y + area.height - 1);
+    CHECK(bounds->min_byte == area.x / 4);
+    CHECK(bounds->max_byte == (area.x + area.width - 1) / 4);
+}
+
+static void test_highlevel_area_update(EpdiyHighlevelState* hl) {
+    DrivenBounds bounds;
+    reset_bounds(&bounds);
+    epd_host_set_frame_cb(record_bounds, &bounds);
+
+    EpdRect area = { .x = 100, .y = 200, .width = 300, .height = 120 };
+    epd_fill_rect(area, 0x00, epd_hl_get_framebuffer(hl));
+    enum EpdDrawError err = epd_hl_update_area(hl, MODE_GC16, 25, epd_full_screen());
+    CHECK(err == EPD_DRAW_SUCCESS);
+    check_bounds(&bounds, area);
+
+    EpdUpdateStats stats;
+    CHECK(epd_get_update_stats(&stats, 1) == 1);
+    CHECK(stats.frames == bounds.frames);
+    CHECK(stats.dirty_area.x == area.x && stats.dirty_area.width == area.width);
+    CHECK(stats.dirty_area.y == area.y && stats.dirty_area.height == area.height);
+    CHECK(stats.error == EPD_DRAW_SUCCESS);
+
+    epd_host_set_frame_cb(NULL, NULL);
+    printf("highlevel area update: %d frames\n", bounds.frames);
+}
+
+/// Changes outside the updated area on the same rows are left for a later update.
+static void test_update_beside_change(EpdiyHighlevelState* hl, bool track_dirty_tiles) {
+    epd_hl_set_dirty_tracking(hl, track_dirty_tiles);
+    DrivenBounds bounds;
+    reset_bounds(&bounds);
+    epd_host_set_frame_cb(record_bounds, &bounds);
+
+    EpdRect area = { .x = 100, .y = 400, .width = 100, .height = 40 };
+    EpdRect beside = { .x = 600, .y = 400, .width = 100, .height = 40 };
+    uint8_t* fb = epd_hl_get_framebuffer(hl);
+    uint8_t color = track_dirty_tiles ? 0x80 : 0x00;
+    uint8_t* beside_back = hl->back_fb + beside.y * epd_width() / 2 + beside.x / 2;
+    uint8_t previous = *beside_back;
+    epd_fill_rect(area, color, fb);
+    epd_fill_rect(beside, color, fb);
+    CHECK(epd_hl_update_area(hl, MODE_GC16, 25, area) == EPD_DRAW_SUCCESS);
+    check_bounds(&bounds, area);
+    CHECK(*beside_back == previous);
+
+    reset_bounds(&bounds);
+    CHECK(epd_hl_update_area(hl, MODE_GC16, 25, epd_full_screen()) == EPD_DRAW_SUCCESS);
+    check_bounds(&bounds, beside);
+    CHECK(memcmp(hl->front_fb, hl->back_fb, epd_width() / 2 * epd_height()) == 0);
+
+    epd_hl_set_dirty_tracking(hl, false);
+    epd_host_set_frame_cb(NULL, NULL);
+    printf("update beside change, tracking %d: %d frames\n", track_dirty_tiles, bounds.frames);
+}
+
+/// Areas narrower than the 16 byte blocks of the vector routines, at unaligned offsets.
+static void test_narrow_areas(EpdiyHighlevelState* hl) {
+    EpdRect areas[] = {
+        { .x = 2, .y = 10, .width = 4, .height = 4 },
+        { .x = 40, .y = 100, .width = 20, .height = 20 },
+        { .x = 1191, .y = 30, .width = 9, .height = 3 },
+    };
+    DrivenBounds bounds;
+    epd_host_set_frame_cb(record_bounds, &bounds);
+    for (int i = 0; i < sizeof(areas) / sizeof(areas[0]); i++) {
+        reset_bounds(&bounds);
+        epd_fill_rect(areas[i], 0x00, epd_hl_get_framebuffer(hl));
+        CHECK(epd_hl_update_area(hl, MODE_GC16, 25, areas[i]) == EPD_DRAW_SUCCESS);
+        check_bounds(&bounds, areas[i]);
+    }
+    CHECK(memcmp(hl->front_fb, hl->back_fb, epd_width() / 2 * epd_height()) == 0);
+
+    epd_host_set_frame_cb(NULL, NULL);
+    printf("narrow areas: ok\n");
+}
+
+static void test_concurrent_regions(EpdiyHighlevelState* hl) {
+    DrivenBounds bounds;
+    reset_bounds(&bounds);
+    epd_host_set_frame_cb(record_bounds, &bounds);
+
+    EpdRect image = { .x = 0, .y = 400, .width = 400, .height = 200 };
+    EpdRect clock = { .x = 800, .y = 64, .width = 200, .height = 64 };
+    uint8_t* fb = epd_hl_get_framebuffer(hl);
+    epd_fill_rect(image, 0x80, fb);
+    epd_fill_rect(clock, 0x00, fb);
+
+    int tile_columns = (epd_width() + EPD_HL_GHOSTING_TILE_SIZE - 1) / EPD_HL_GHOSTING_TILE_SIZE;
+    uint8_t* clock_counter = &hl->ghosting_counters
+        [clock.y / EPD_HL_GHOSTING_TILE_SIZE * tile_columns + clock.x / EPD_HL_GHOSTING_TILE_SIZE];
+    uint8_t* image_counter = &hl->ghosting_counters
+        [image.y / EPD_HL_GHOSTING_TILE_SIZE * tile_columns + image.x / EPD_HL_GHOSTING_TILE_SIZE];
+    uint8_t clock_count = *clock_counter;
+    uint8_t image_count = *image_counter;
+
+    int image_region, clock_region;
+    CHECK(epd_hl_update_area_async(hl, MODE_GC16, 25, image, &image_region) == EPD_DRAW_SUCCESS);
+    CHECK(epd_hl_update_area_async(hl, MODE_DU, 25, clock, &clock_region) == EPD_DRAW_SUCCESS);
+    CHECK(epd_region_wait(clock_region) == EPD_DRAW_SUCCESS);
+    CHECK(epd_region_wait(image_region) == EPD_DRAW_SUCCESS);
+    // only the fast update counts towards the ghosting cleanup
+    CHECK(*clock_counter == clock_count + 1);
+    CHECK(*image_counter == image_count);
+
+    CHECK(bounds.frames > 0);
+    CHECK(bounds.min_line == clock.y);
+    CHECK(bounds.max_line == image.y + image.height - 1);
+
+    epd_host_set_frame_cb(NULL, NULL);
+    printf("concurrent regions: %d frames\n", bounds.frames);
+}
+
+/// Difference updates of framebuffers with 2 and 1 bits per pixel.
+static void test_packed_framebuffers() {
+    EpdRect screen = epd_full_screen();
+    EpdRect area = { .x = 204, .y = 300, .width = 77, .height = 40 };
+    bool* dirty_lines = malloc(screen.height * sizeof(bool));
+    uint8_t* dirty_columns = aligned_alloc(16, screen.width / 2);
+    EpdTransitionHistogram transitions;
+    CHECK(dirty_lines != NULL && dirty_columns != NULL);
+
+    // 2 bits per pixel, drawn with the difference calculated while drawing
+    size_t fb_size = epd_framebuffer_line_bytes(EPD_FB_2BPP) * screen.height;
+    uint8_t* to = aligned_alloc(16, fb_size);
+    uint8_t* from = aligned_alloc(16, fb_size);
+    CHECK(to != NULL && from != NULL);
+    memset(to, 0xFF, fb_size);
+    memset(from, 0xFF, fb_size);
+    epd_set_framebuffer_format(to, EPD_FB_2BPP);
+    epd_fill_rect(area, 0x50, to);
+    EpdRect diff = epd_difference_image_packed(
+        to, from, screen, EPD_FB_2BPP, NULL, dirty_lines, dirty_columns, &transitions
+    );
+    CHECK(diff.x == area.x && diff.width == area.width);
+    CHECK(diff.y == area.y && diff.height == area.height);
+    CHECK(transitions.counts[0x5F] == area.width * area.height);
+
+    DrivenBounds bounds;
+    reset_bounds(&bounds);
+    epd_host_set_frame_cb(record_bounds, &bounds);
+    EpdRect band = { .x = 0, .y = diff.y, .width = screen.width, .height = diff.height };
+    enum EpdDrawError err = epd_draw_difference_base(
+        screen,
+        to,
+        from,
+        band,
+        MODE_GC16 | MODE_PACKING_4PPB,
+        25,
+        dirty_lines,
+        dirty_columns,
+        epd_get_display()->default_waveform,
+        &transitions,
+        &diff
+    );
+    CHECK(err == EPD_DRAW_SUCCESS);
+    check_bounds(&bounds, area);
+    CHECK(memcmp(to, from, fb_size) == 0);
+    epd_set_framebuffer_format(to, EPD_FB_4BPP);
+    free(to);
+    free(from);
+
+    // 1 bit per pixel, only the copy back
+    fb_size = epd_framebuffer_line_bytes(EPD_FB_1BPP) * screen.height;
+    to = aligned_alloc(16, fb_size);
+    from = aligned_alloc(16, fb_size);
+    CHECK(to != NULL && from != NULL);
+    memset(to, 0xFF, fb_size);
+    memset(from, 0xFF, fb_size);
+    epd_set_framebuffer_format(to, EPD_FB_1BPP);
+    epd_fill_rect(area, 0x00, to);
+    // a change next to the area is not copied back
+    epd_draw_pixel(area.x + area.width, area.y, 0x00, to);
+    diff = epd_difference_image_packed(
+        to, from, area, EPD_FB_1BPP, NULL, dirty_lines, dirty_columns, NULL
+    );
+    CHECK(diff.x == area.x && diff.width == area.width);
+    epd_difference_copy_back_packed(to, from, diff, EPD_FB_1BPP, dirty_lines);
+    diff = epd_difference_image_packed(
+        to, from, screen, EPD_FB_1BPP, NULL, dirty_lines, dirty_columns, NULL
+    );
+    CHECK(diff.x == area.x + area.width && diff.width == 1 && diff.height == 1);
+    epd_set_framebuffer_format(to, EPD_FB_4BPP);
+    free(to);
+    free(from);
+
+    free(dirty_lines);
+    free(dirty_columns);
+    epd_host_set_frame_cb(NULL, NULL);
+    printf("packed framebuffers: %d frames\n", bounds.frames);
+}
+
+/// Ink flushes drive only the stroke pixels, not other pending changes in their box.
+static void test_ink(EpdiyHighlevelState* hl) {
+    DrivenBounds bounds;
+    reset_bounds(&bounds);
+    EpdRect pending = { .x = 360, .y = 100, .width = 40, .height = 20 };
+    epd_fill_rect(pending, 0x40, epd_hl_get_framebuffer(hl));
+    uint8_t* pending_back = hl->back_fb + pending.y * epd_width() / 2 + pending.x / 2;
+    uint8_t previous = *pending_back;
+
+    EpdInkState ink = epd_hl_ink_begin(hl);
+    epd_host_set_frame_cb(record_bounds, &bounds);
+    EpdInkSegment segment = { .x0 = 300, .y0 = 100, .x1 = 400, .y1 = 200, .width = 3 };
+    CHECK(epd_hl_ink_add(&ink, segment));
+    CHECK(epd_hl_ink_flush(&ink, 25) == EPD_DRAW_SUCCESS);
+    epd_host_set_frame_cb(NULL, NULL);
+    epd_hl_ink_end(&ink);
+    epd_poweron();
+
+    EpdRect stroke = { .x = 299, .y = 99, .width = 103, .height = 103 };
+    check_bounds(&bounds, stroke);
+    CHECK(*pending_back == previous);
+    CHECK(epd_get_pixel(350, 150, epd_width(), epd_height(), hl->back_fb) == 0x00);
+
+    CHECK(epd_hl_update_area(hl, MODE_GC16, 25, epd_full_screen()) == EPD_DRAW_SUCCESS);
+    CHECK(memcmp(hl->front_fb, hl->back_fb, epd_width() / 2 * epd_height()) == 0);
+    printf("ink: %d frames\n", bounds.frames);
+}
+
+/// Gray level of the stripe drawn to rotated row `y` of a scrolled area.
+static uint8_t stripe_color(int y) {
+    return (y % 16) * 0x11;
+}
+
+/// The front framebuffer pixel at rotated coordinates.
+static uint8_t rotated_pixel(EpdiyHighlevelState* hl, int x, int y) {
+    if (epd_get_rotation() == EPD_ROT_PORTRAIT) {
+        int physical_x = epd_width() - 1 - y;
+        y = x;
+        x = physical_x;
+    }
+    return epd_get_pixel(x, y, epd_width(), epd_height(), epd_hl_get_framebuffer(hl));
+}
+
+static void check_scroll(EpdiyHighlevelState* hl, EpdRect area, int dy) {
+    uint8_t* fb = epd_hl_get_framebuffer(hl);
+    for (int y = area.y; y < area.y + area.height; y++) {
+        EpdRect row = { .x = area.x, .y = y, .width = area.width, .height = 1 };
+        epd_fill_rect(row, stripe_color(y), fb);
+    }
+    uint8_t left = rotated_pixel(hl, area.x - 1, area.y);
+    uint8_t right = rotated_pixel(hl, area.x + area.width, area.y);
+
+    EpdRect exposed = epd_hl_scroll(hl, area, dy);
+    CHECK(exposed.x == area.x && exposed.width == area.width);
+    CHECK(exposed.height == abs(dy));
+    CHECK(exposed.y == (dy > 0 ? area.y : area.y + area.height + dy));
+    for (int y = area.y; y < area.y + area.height; y++) {
+        if (y >= exposed.y && y < exposed.y + exposed.height) {
+            continue;
+        }
+        CHECK(rotated_pixel(hl, area.x, y) == (stripe_color(y - dy) & 0xF0));
+        CHECK(rotated_pixel(hl, area.x + area.width - 1, y) == (stripe_color(y - dy) & 0xF0));
+    }
+    CHECK(rotated_pixel(hl, area.x - 1, area.y) == left);
+    CHECK(rotated_pixel(hl, area.x + area.width, area.y) == right);
+}
+
+static void test_scroll(EpdiyHighlevelState* hl) {
+    EpdRect area = { .x = 501, .y = 640, .width = 203, .height = 120 };
+    check_scroll(hl, area, -7);
+    check_scroll(hl, area, 30);
+    CHECK(epd_hl_update_area(hl, MODE_DU, 25, area) == EPD_DRAW_SUCCESS);
+
+    epd_set_rotation(EPD_ROT_PORTRAIT);
+    EpdRect portrait = { .x = 65, .y = 501, .width = 90, .height = 203 };
+    check_scroll(hl, portrait, 9);
+    check_scroll(hl, portrait, -12);
+    epd_set_rotation(EPD_ROT_LANDSCAPE);
+    CHECK(epd_hl_update_area(hl, MODE_DU, 25, epd_full_screen()) == EPD_DRAW_SUCCESS);
+    printf("scroll: ok\n");
+}
+
+static void test_draw_base_gradient() {
+    EpdRect area = epd_full_screen();
+    uint8_t* fb = malloc(area.width / 2 * area.height);
+    CHECK(fb != NULL);
+    for (int y = 0; y < area.height; y++) {
+        for (int x = 0; x < area.width / 2; x++) {
+            uint8_t color = x * 32 / area.width;
+            fb[y * area.width / 2 + x] = color | (color << 4);
+        }
+    }
+
+    enum EpdDrawError err = epd_draw_base(
+        area,
+        fb,
+        area,
+        MODE_GL16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+        25,
+        NULL,
+        NULL,
+        epd_get_display()->default_waveform
+    );
+    CHECK(err == EPD_DRAW_SUCCESS);
+    free(fb);
+}
+
+int main() {
+    epd_init(&epd_board_host, &ED097TC2, EPD_LUT_1K);
+    EpdiyHighlevelState hl = epd_hl_init(EPD_BUILTIN_WAVEFORM);
+
+    epd_poweron();
+    CHECK(epd_host_powered());
+    test_highlevel_area_update(&hl);
+    test_update_beside_change(&hl, false);
+    test_update_beside_change(&hl, true);
+    test_narrow_areas(&hl);
+    test_concurrent_regions(&hl);
+    test_packed_framebuffers();
+    test_scroll(&hl);
+    test_ink(&hl);
+    test_draw_base_gradient();
+    epd_poweroff();
+
+    epd_deinit();
+    printf("all checks passed\n");
+    return 0;
+}
@@ -69,14 +69,34 @@ extern "C" {
 
 #define EPD_BUILTIN_WAVEFORM NULL
 
+/// Edge length in pixels of the square tiles for ghosting accounting.
+#define EPD_HL_GHOSTING_TILE_SIZE 64
+
 /// Holds the internal state of the high-level API.
 typedef struct {
+    /// Pixel format of the framebuffers.
+    enum EpdFramebufferFormat format;
     /// The "front" framebuffer object.
     uint8_t* front_fb;
     /// The "back" framebuffer object.
     uint8_t* back_fb;
     /// Buffer for holding the interlaced difference image.
+    /// NULL if the render method calculates the difference while drawing.
+    /// With `EPD_FB_1BPP`, the 1 bit per pixel image of the pixels driven by an update pass.
     uint8_t* difference_fb;
+    /// Number of fast (non-GC16) updates per tile since it was last cleaned,
+    /// row by row in tiles of `EPD_HL_GHOSTING_TILE_SIZE`.
+    uint8_t* ghosting_counters;
+    /// Tiles with this many fast updates are cleaned by `epd_hl_clean_ghosting()`.
+    /// Zero disables the cleanup.
+    int ghosting_threshold;
+    /// Tiles of the front framebuffer changed since their last update,
+    /// as recorded by the drawing functions. See `epd_track_dirty_tiles()`.
+    uint8_t* dirty_tiles;
+    /// If set, updates only compare the tiles marked in `dirty_tiles`.
+    bool track_dirty_tiles;
+    /// Gray level transitions of the pixels drawn by the last update.
+    EpdTransitionHistogram* transitions;
     /// Tainted lines based on the last difference calculation.
     bool* dirty_lines;
     /// Tainted column nibbles based on the last difference calculation.
@@ -97,6 +117,24 @@ typedef struct {
  */
 EpdiyHighlevelState epd_hl_init(const EpdWaveform* waveform);
 
+/**
+ * Like `epd_hl_init()`, but with framebuffers of 2 or 1 bits per pixel,
+ * for user interfaces with 4 gray levels or black and white only.
+ * The drawing functions round colors to the levels of the format.
+ *
+ * With `EPD_FB_1BPP`, updates drive the pixels turning black and those turning white
+ * in two short passes of the `mode` waveform, with `MODE_PACKING_8PPB` data.
+ * With `EPD_FB_2BPP`, the render threads expand the lines while drawing.
+ * Concurrent updates with `epd_hl_update_area_async()` are not supported.
+ *
+ * @param waveform: See `epd_hl_init()`.
+ * @param format: Format of the framebuffers.
+ * @returns An initialized state object.
+ */
+EpdiyHighlevelState epd_hl_init_format(
+    const EpdWaveform* waveform, enum EpdFramebufferFormat format
+);
+
 /// Get a reference to the front framebuffer.
 /// Use this to draw on the framebuffer before updating the screen with `epd_hl_update_screen()`.
 uint8_t* epd_hl_get_framebuffer(EpdiyHighlevelState* state);
@@ -111,6 +149,7 @@ uint8_t* epd_hl_get_framebuffer(EpdiyHighlevelState* state);
  * 		Additional mode settings like the framebuffer format or
  * 		previous display state are determined by the driver and must not be supplied here.
  * 		In most cases, one of `MODE_GC16` and `MODE_GL16` should be used.
+ * 		With `MODE_AUTO`, the fastest mode that reaches all changed gray levels is chosen.
  * @param temperature: Environmental temperature of the display in °C.
  * @returns `EPD_DRAW_SUCCESS` on sucess, a combination of error flags otherwise.
  */
@@ -120,7 +159,9 @@ enum EpdDrawError epd_hl_update_screen(
 
 /**
  * Update an area of the screen to match the content of the front framebuffer.
- * Supplying a small area to update can speed up the update process.
+ * Supplying a small area to update can speed up the update process:
+ * Only the rows containing changes are driven, and only the changed
+ * pixels are copied to the back framebuffer afterwards.
  * Prior to this, power to the display must be enabled via `epd_poweron()`
  * and should be disabled afterwards if no immediate additional updates follow.
  *
@@ -134,6 +175,88 @@ enum EpdDrawError epd_hl_update_area(
     EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area
 );
 
+/**
+ * Start updating an area of the screen to match the front framebuffer and
+ * return without waiting, using a concurrent update region (see `epd_region_start()`).
+ * Other areas can be started the same way while this update is still in progress,
+ * each with its own mode, e.g. a clock in `MODE_DU` next to an image in `MODE_GC16`.
+ * All pixels of the area are driven.
+ * Like with `epd_hl_update_area()`, tiles changed by fast modes count towards
+ * the ghosting cleanup.
+ *
+ * The area of the front framebuffer must not be modified until the update
+ * is complete, wait for it with `epd_region_wait()`.
+ *
+ * @param state: A reference to the `EpdiyHighlevelState` object used.
+ * @param mode: See `epd_hl_update_screen()`.
+ * @param temperature: Environmental temperature of the display in °C.
+ * @param area: Area of the screen to update, must not overlap a running update.
+ * @param region: Set to the handle of the started region update.
+ * @returns `EPD_DRAW_SUCCESS` if the update was started, a combination of error flags otherwise.
+ *      `EPD_DRAW_LOOKUP_NOT_IMPLEMENTED` for framebuffers of 2 or 1 bits per pixel.
+ */
+enum EpdDrawError epd_hl_update_area_async(
+    EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area, int* region
+);
+
+/**
+ * Set the number of fast updates after which a tile is cleaned
+ * by `epd_hl_clean_ghosting()`. Zero disables the cleanup.
+ */
+void epd_hl_set_ghosting_threshold(EpdiyHighlevelState* state, int threshold);
+
+/**
+ * Refresh all tiles which exceeded the ghosting threshold with `MODE_GC16`,
+ * driving every pixel of the tiles. The counters of the refreshed tiles are reset.
+ * Also called by `epd_hl_flush()`.
+ * Like for `epd_hl_update_area()`, power to the display must be enabled before.
+ *
+ * @returns `EPD_DRAW_SUCCESS` on sucess, a combination of error flags otherwise.
+ */
+enum EpdDrawError epd_hl_clean_ghosting(EpdiyHighlevelState* state, int temperature);
+
+/**
+ * Enable or disable dirty tile tracking of the front framebuffer.
+ * With tracking, updates only compare the tiles changed by the drawing functions
+ * (`epd_draw_pixel()`, `epd_write_string()`, `epd_copy_to_framebuffer()`, ...)
+ * instead of the whole update area.
+ * Direct writes to the framebuffer must then be reported with `epd_hl_mark_dirty()`.
+ *
+ * Only has an effect on render methods calculating the difference while drawing.
+ * Enabling marks all tiles as dirty.
+ */
+void epd_hl_set_dirty_tracking(EpdiyHighlevelState* state, bool enable);
+
+/// Mark an area of the front framebuffer as changed, e.g. after writing to it directly.
+void epd_hl_mark_dirty(EpdiyHighlevelState* state, EpdRect area);
+
+/**
+ * Clear the dirty marks of all tiles completely inside `area`,
+ * as done by the update functions.
+ * Use this when updating the area from a copy of the front framebuffer and tile map.
+ */
+void epd_hl_clear_dirty(EpdiyHighlevelState* state, EpdRect area);
+
+/**
+ * Scroll the contents of an area of the front framebuffer by `dy` rows,
+ * down for positive and up for negative values.
+ * Content moved out of the area is discarded, the band it leaves uncovered keeps
+ * its old pixels and has to be redrawn by the caller.
+ * The area is marked as changed for dirty tile tracking.
+ *
+ * Only the front framebuffer is modified, so a following `epd_hl_update_area()` drives
+ * just the pixels that changed. Use a fast mode like `MODE_DU` or `MODE_AUTO` for it
+ * and let `epd_hl_clean_ghosting()` refresh the tiles after repeated scrolls.
+ *
+ * In landscape orientations, rows are moved as a whole. In portrait orientations,
+ * they are columns of the framebuffer and moved pixel by pixel.
+ *
+ * @param area: The scrolled area, clipped to the display.
+ * @returns The uncovered band to redraw, empty if `dy` is zero or the area is empty.
+ *  The whole area if `dy` is at least its height.
+ */
+EpdRect epd_hl_scroll(EpdiyHighlevelState* state, EpdRect area, int dy);
+
 /**
  * Reset the front framebuffer to a white state.
  *
@@ -152,6 +275,137 @@ void epd_fullclear(EpdiyHighlevelState* state, int temperature);
  */
 void epd_hl_waveform(EpdiyHighlevelState* state, const EpdWaveform* waveform);
 
+/// Maximum number of separate areas a refresh scheduler keeps pending.
+#define EPD_HL_MAX_PENDING_AREAS 8
+
+/// An invalidated area waiting for an update.
+typedef struct {
+    /// Area of the screen to update, in rotated coordinates.
+    EpdRect area;
+    /// The requested update mode.
+    enum EpdDrawMode mode;
+} EpdPendingArea;
+
+/**
+ * Collects invalidated areas and merges them, so that many small
+ * changes can be applied with few waveform passes.
+ */
+typedef struct {
+    /// Pending areas, in the order they are updated.
+    EpdPendingArea pending[EPD_HL_MAX_PENDING_AREAS];
+    /// Number of valid entries in `pending`.
+    int num_pending;
+    /// Areas with the same mode closer than this many pixels are merged.
+    int merge_distance;
+    /// Minimum time between two scheduled flushes in milliseconds.
+    int interval_ms;
+    /// Time of the last flush in microseconds, as reported by `esp_timer_get_time()`.
+    int64_t last_flush_us;
+} EpdRefreshScheduler;
+
+/**
+ * Create an empty refresh scheduler.
+ *
+ * @param merge_distance: Areas with the same mode closer than this are merged.
+ * @param interval_ms: Minimum time between two scheduled flushes.
+ */
+EpdRefreshScheduler epd_hl_scheduler_init(int merge_distance, int interval_ms);
+
+/**
+ * Mark an area of the screen for update with the given mode.
+ * The area is merged with overlapping or nearby pending areas of the same mode.
+ *
+ * @returns `false` if the area could not be queued because the scheduler is full.
+ *      In this case, flush the scheduler and try again.
+ */
+bool epd_hl_invalidate(EpdRefreshScheduler* sched, EpdRect area, enum EpdDrawMode mode);
+
+/// Check whether there are pending areas and the flush interval has elapsed.
+bool epd_hl_scheduler_due(const EpdRefreshScheduler* sched);
+
+/**
+ * Move all pending areas into a new scheduler and reset the flush interval.
+ * Use this to hand pending work to another task while new areas are collected.
+ */
+EpdRefreshScheduler epd_hl_scheduler_take(EpdRefreshScheduler* sched);
+
+/**
+ * Update all pending areas, one waveform pass per area, and clear the scheduler.
+ * Afterwards, tiles exceeding the ghosting threshold are cleaned.
+ * Like for `epd_hl_update_area()`, power to the display must be enabled before.
+ *
+ * @returns `EPD_DRAW_SUCCESS` on sucess, a combination of error flags of all updates otherwise.
+ */
+enum EpdDrawError epd_hl_flush(
+    EpdRefreshScheduler* sched, EpdiyHighlevelState* state, int temperature
+);
+
+/// Maximum number of stroke segments waiting to be inked.
+#define EPD_HL_INK_QUEUE_LENGTH 64
+
+/// A straight piece of a pen stroke, in rotated coordinates.
+typedef struct {
+    int16_t x0;
+    int16_t y0;
+    int16_t x1;
+    int16_t y1;
+    /// Stroke width in pixels, at least 1.
+    uint8_t width;
+} EpdInkSegment;
+
+/**
+ * State of a low latency ink session, for handwriting and drag feedback.
+ *
+ * Stroke segments are drawn black with one short `MODE_A2` update each flush,
+ * using `MODE_PACKING_8PPB` data and driving only the rows they touch.
+ * The display stays powered for the whole session.
+ */
+typedef struct {
+    /// The high-level state the strokes are drawn into.
+    EpdiyHighlevelState* hl;
+    /// Full screen 1 bit per pixel image of the strokes to ink, a cleared bit is inked.
+    uint8_t* layer;
+    /// Mode used for inking, `MODE_A2` if the waveform has it, `MODE_DU` otherwise.
+    enum EpdDrawMode mode;
+    /// Segments waiting for the next flush.
+    EpdInkSegment queue[EPD_HL_INK_QUEUE_LENGTH];
+    /// Index of the next segment to add, only written by `epd_hl_ink_add()`.
+    int queue_head;
+    /// Index of the next segment to draw, only written by `epd_hl_ink_flush()`.
+    int queue_tail;
+} EpdInkState;
+
+/**
+ * Start an ink session and power on the display.
+ * No other updates of `state` must run until `epd_hl_ink_end()`.
+ */
+EpdInkState epd_hl_ink_begin(EpdiyHighlevelState* state);
+
+/**
+ * Queue a stroke segment for the next flush.
+ * This may be called from another task than the flushes, but only from one.
+ *
+ * @returns `false` if the queue is full. In this case, flush and try again.
+ */
+bool epd_hl_ink_add(EpdInkState* ink, EpdInkSegment segment);
+
+/**
+ * Draw all queued segments into the front framebuffer and ink them on the display
+ * with one short update of the rows they touch.
+ * Only the stroke pixels are driven, other changes of the front framebuffer
+ * are left for a regular update.
+ * Segments queued meanwhile are drawn by the next flush.
+ *
+ * @returns `EPD_DRAW_SUCCESS` if there was nothing to draw or the update succeeded.
+ */
+enum EpdDrawError epd_hl_ink_flush(EpdInkState* ink, int temperature);
+
+/**
+ * End an ink session and power off the display.
+ * Segments still queued are dropped, flush them before.
+ */
+void epd_hl_ink_end(EpdInkState* ink);
+
 #ifdef __cplusplus
 }
 #endif
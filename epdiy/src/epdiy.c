@@ -8,6 +8,7 @@
 #include <esp_heap_caps.h>
 #include <esp_log.h>
 #include <esp_types.h>
+#include <string.h>
 
 // Simple x and y coordinate
 typedef struct {
@@ -20,6 +21,22 @@ static const EpdDisplay_t* display = NULL;
 // Display rotation. Can be updated using epd_set_rotation(enum EpdRotation)
 static enum EpdRotation display_rotation = EPD_ROT_LANDSCAPE;
 
+// Framebuffer whose changes are recorded in `dirty_tile_map`, if any.
+static const uint8_t* tracked_framebuffer = NULL;
+static uint8_t* dirty_tile_map = NULL;
+static int dirty_tile_columns = 0;
+
+// Framebuffer drawn with a format other than 4 bits per pixel, if any.
+static const uint8_t* packed_framebuffer = NULL;
+static enum EpdFramebufferFormat packed_format = EPD_FB_4BPP;
+
+static inline int min(int x, int y) {
+    return x < y ? x : y;
+}
+static inline int max(int x, int y) {
+    return x > y ? x : y;
+}
+
 #ifndef _swap_int
 #define _swap_int(a, b) \
     {                   \
@@ -73,6 +90,26 @@ Coord_xy _rotate(uint16_t x, uint16_t y) {
     return coord;
 }
 
+/// Set a pixel of a framebuffer to a gray level from 0x0 to 0xF, rounded to its format.
+static inline void write_pixel(uint8_t* framebuffer, int x, int y, uint8_t level) {
+    if (framebuffer == packed_framebuffer && packed_format == EPD_FB_1BPP) {
+        uint8_t* buf_ptr = &framebuffer[y * epd_width() / 8 + x / 8];
+        uint8_t bit = 1 << (x % 8);
+        *buf_ptr = level >= 0x8 ? *buf_ptr | bit : *buf_ptr & ~bit;
+    } else if (framebuffer == packed_framebuffer && packed_format == EPD_FB_2BPP) {
+        uint8_t* buf_ptr = &framebuffer[y * epd_width() / 4 + x / 4];
+        int shift = 2 * (x % 4);
+        *buf_ptr = (*buf_ptr & ~(0x3 << shift)) | (((level + 2) / 5) << shift);
+    } else {
+        uint8_t* buf_ptr = &framebuffer[y * epd_width() / 2 + x / 2];
+        if (x % 2) {
+            *buf_ptr = (*buf_ptr & 0x0F) | (level << 4);
+        } else {
+            *buf_ptr = (*buf_ptr & 0xF0) | level;
+        }
+    }
+}
+
 void epd_draw_pixel(int x, int y, uint8_t color, uint8_t* framebuffer) {
     // Check rotation and move pixel around if necessary
     Coord_xy coord = _rotate(x, y);
@@ -86,11 +123,65 @@ void epd_draw_pixel(int x, int y, uint8_t color, uint8_t* framebuffer) {
         return;
     }
 
-    uint8_t* buf_ptr = &framebuffer[y * epd_width() / 2 + x / 2];
-    if (x % 2) {
-        *buf_ptr = (*buf_ptr & 0x0F) | (color & 0xF0);
-    } else {
-        *buf_ptr = (*buf_ptr & 0xF0) | (color >> 4);
+    if (framebuffer == tracked_framebuffer) {
+        dirty_tile_map
+            [y / EPD_DIRTY_TILE_SIZE * dirty_tile_columns + x / EPD_DIRTY_TILE_SIZE]
+            = 1;
+    }
+
+    write_pixel(framebuffer, x, y, color >> 4);
+}
+
+int epd_dirty_tile_count() {
+    int columns = (epd_width() + EPD_DIRTY_TILE_SIZE - 1) / EPD_DIRTY_TILE_SIZE;
+    int rows = (epd_height() + EPD_DIRTY_TILE_SIZE - 1) / EPD_DIRTY_TILE_SIZE;
+    return columns * rows;
+}
+
+void epd_track_dirty_tiles(const uint8_t* framebuffer, uint8_t* tile_map) {
+    assert(framebuffer == NULL || tile_map != NULL);
+    dirty_tile_columns = (epd_width() + EPD_DIRTY_TILE_SIZE - 1) / EPD_DIRTY_TILE_SIZE;
+    dirty_tile_map = framebuffer != NULL ? tile_map : NULL;
+    tracked_framebuffer = framebuffer;
+}
+
+int epd_framebuffer_line_bytes(enum EpdFramebufferFormat format) {
+    switch (format) {
+        case EPD_FB_1BPP:
+            return epd_width() / 8;
+        case EPD_FB_2BPP:
+            return epd_width() / 4;
+        default:
+            return epd_width() / 2;
+    }
+}
+
+void epd_set_framebuffer_format(const uint8_t* framebuffer, enum EpdFramebufferFormat format) {
+    if (format == EPD_FB_4BPP) {
+        if (framebuffer == packed_framebuffer) {
+            packed_framebuffer = NULL;
+        }
+        return;
+    }
+    packed_framebuffer = framebuffer;
+    packed_format = format;
+}
+
+void epd_mark_dirty(const uint8_t* framebuffer, EpdRect area) {
+    if (framebuffer == NULL || framebuffer != tracked_framebuffer) {
+        return;
+    }
+    int x_start = max(area.x, 0);
+    int y_start = max(area.y, 0);
+    int x_end = min(area.x + area.width, epd_width());
+    int y_end = min(area.y + area.height, epd_height());
+    if (x_end <= x_start || y_end <= y_start) {
+        return;
+    }
+    int first_column = x_start / EPD_DIRTY_TILE_SIZE;
+    int columns = (x_end - 1) / EPD_DIRTY_TILE_SIZE - first_column + 1;
+    for (int ty = y_start / EPD_DIRTY_TILE_SIZE; ty <= (y_end - 1) / EPD_DIRTY_TILE_SIZE; ty++) {
+        memset(dirty_tile_map + ty * dirty_tile_columns + first_column, 1, columns);
     }
 }
 
@@ -339,6 +430,7 @@ void epd_fill_triangle(
 
 void epd_copy_to_framebuffer(EpdRect image_area, const uint8_t* image_data, uint8_t* framebuffer) {
     assert(framebuffer != NULL);
+    epd_mark_dirty(framebuffer, image_area);
 
     for (uint32_t i = 0; i < image_area.width * image_area.height; i++) {
         uint32_t value_index = i;
@@ -358,12 +450,7 @@ void epd_copy_to_framebuffer(EpdRect image_area, const uint8_t* image_data, uint
         if (yy < 0 || yy >= epd_height()) {
             continue;
         }
-        uint8_t* buf_ptr = &framebuffer[yy * epd_width() / 2 + xx / 2];
-        if (xx % 2) {
-            *buf_ptr = (*buf_ptr & 0x0F) | (val << 4);
-        } else {
-            *buf_ptr = (*buf_ptr & 0xF0) | val;
-        }
+        write_pixel(framebuffer, xx, yy, val);
     }
 }
 
@@ -26,14 +26,23 @@ typedef struct {
     int height;
 } EpdRect;
 
+/**
+ * Number of pixels per gray level transition in a difference image,
+ * indexed by `(to << 4) | from`, like the `MODE_PACKING_1PPB_DIFFERENCE` pixels.
+ */
+typedef struct {
+    uint32_t counts[256];
+} EpdTransitionHistogram;
+
 /// Global EPD driver options.
 enum EpdInitOptions {
     /// Use the default options.
     EPD_OPTIONS_DEFAULT = 0,
-    /// Use a small look-up table of 1024 bytes.
+    /// Use a small look-up table of 1024 bytes. (default for the LCD render method)
     /// The EPD driver will use less space, but performance may be worse.
+    /// On the ESP32-S3, difference images are always converted with the 1K table.
     EPD_LUT_1K = 1,
-    /// Use a 64K lookup table. (default)
+    /// Use a 64K lookup table. (default for the I2S render method)
     /// Best performance, but permanently occupies a 64k block of internal memory.
     EPD_LUT_64K = 2,
 
@@ -45,6 +54,24 @@ enum EpdInitOptions {
     EPD_FEED_QUEUE_32 = 8,
 };
 
+/// Run a render thread on any core.
+#define EPD_RENDER_ANY_CORE -1
+
+/// Configuration of the render threads, which prepare line data during updates.
+typedef struct {
+    /// Number of render threads, 1 or 2. (default: 2)
+    /// The I2S render method always uses 2 threads.
+    int num_threads;
+    /// FreeRTOS priority of the render threads. (default: `configMAX_PRIORITIES - 1`)
+    /// While an update is drawn, they starve tasks of lower priority on their cores.
+    int priority;
+    /// Core of each render thread, or `EPD_RENDER_ANY_CORE`. (default: 0 and 1)
+    int core[2];
+} EpdRenderThreadConfig;
+
+/// Maximum number of update regions drawn at the same time, see `epd_region_start()`.
+#define EPD_MAX_UPDATE_REGIONS 4
+
 /// The image drawing mode.
 enum EpdDrawMode {
     /// An init waveform.
@@ -84,6 +111,10 @@ enum EpdDrawMode {
     /// Monochrome mode. Only supported with 1bpp buffers.
     MODE_EPDIY_MONOCHROME = 0x20,
 
+    /// Choose the fastest mode of the waveform that can reach all target gray levels
+    /// of the changed pixels. Only supported by the high-level API.
+    MODE_AUTO = 0x3E,
+
     MODE_UNKNOWN_WAVEFORM = 0x3F,
 
     // Framebuffer packing modes
@@ -99,7 +130,10 @@ enum EpdDrawMode {
     /// The upper nibble marks the "from" color,
     /// the lower nibble the "to" color.
     MODE_PACKING_1PPB_DIFFERENCE = 0x100,
-    // reserver for 4PPB mode
+    /// 2 bit-per-pixel goal and previous images of a difference update
+    /// (`epd_draw_difference_base()`), with the gray levels 0x0, 0x5, 0xA and 0xF.
+    /// The lowest two bits correspond to the leftmost pixel.
+    MODE_PACKING_4PPB = 0x1000,
 
     /// Assert that the display has a uniform color, e.g. after initialization.
     /// If `MODE_PACKING_2PPB` is specified, a optimized output calculation can be used.
@@ -114,6 +148,16 @@ enum EpdDrawMode {
     MODE_FORCE_NO_PIE = 0x800,
 };
 
+/// Pixel format of a framebuffer, see `epd_set_framebuffer_format()`.
+enum EpdFramebufferFormat {
+    /// 4 bits per pixel, like `MODE_PACKING_2PPB`. (default)
+    EPD_FB_4BPP = 0,
+    /// 2 bits per pixel, like `MODE_PACKING_4PPB`.
+    EPD_FB_2BPP = 1,
+    /// 1 bit per pixel, like `MODE_PACKING_8PPB`.
+    EPD_FB_1BPP = 2,
+};
+
 /** Display software rotation.
  *  Sets the rotation for the purposes of the drawing and font functions
  *  Use epd_set_rotation(EPD_ROT_*) to set it using one of the options below
@@ -163,6 +207,10 @@ enum EpdDrawError {
     ///
     /// Reduce the display clock speed.
     EPD_DRAW_EMPTY_LINE_QUEUE = 0x400,
+
+    /// No update region is free, the area overlaps an active region,
+    /// or the framebuffers differ from those of the active regions.
+    EPD_DRAW_REGION_UNAVAILABLE = 0x800,
 };
 
 /// The default draw mode (non-flashy refresh, whith previously white screen).
@@ -206,6 +254,20 @@ void epd_init(
     const EpdBoardDefinition* board, const EpdDisplay_t* display, enum EpdInitOptions options
 );
 
+/**
+ * Configure the render threads. This must be called before `epd_init()`,
+ * the configuration is kept across re-initialization.
+ *
+ * For example, a single thread on core 1 leaves core 0 to other tasks during updates,
+ * at the cost of update speed.
+ */
+void epd_set_render_thread_config(const EpdRenderThreadConfig* config);
+
+/**
+ * Get the current render thread configuration.
+ */
+EpdRenderThreadConfig epd_get_render_thread_config();
+
 /**
  * Get the configured display.
  */
@@ -529,6 +591,221 @@ enum EpdDrawError epd_draw_base(
     const uint8_t* drawn_columns,
     const EpdWaveform* waveform
 );
+
+/**
+ * Like `epd_draw_base()` with `MODE_PACKING_1PPB_DIFFERENCE`, but the difference
+ * image is never stored: The render threads interlace the lines of `to` and `from`
+ * on the fly while drawing each frame.
+ * This saves a difference buffer of twice the framebuffer size.
+ * Currently only implemented for the LCD render method, the `area` must span the full width.
+ *
+ * Optionally, `from` is updated to `to` as part of the update, as with
+ * `epd_difference_copy_back()`. The copy runs while the last frame is still
+ * being output, once the render threads are done reading `from`.
+ *
+ * @param area: The area of the screen to draw to.
+ * @param to: The goal image as 4-bpp (`MODE_PACKING_2PPB`) framebuffer, 16 byte aligned.
+ * @param from: The previous image as 4-bpp (`MODE_PACKING_2PPB`) framebuffer, 16 byte aligned.
+ * @param crop_to: See `epd_draw_base()`.
+ * @param mode: The waveform mode, `MODE_PACKING_1PPB_DIFFERENCE` is implied.
+ *      With `MODE_PACKING_4PPB`, `to` and `from` have 2 bits per pixel instead.
+ * @param temperature: See `epd_draw_base()`.
+ * @param drawn_lines: See `epd_draw_base()`.
+ * @param drawn_columns: See `epd_draw_base()`.
+ * @param waveform: See `epd_draw_base()`.
+ * @param transitions: If not NULL, the transitions present in the drawn pixels,
+ *      as calculated by `epd_difference_transitions()`.
+ *      Waveform frames that do not drive any of these transitions are skipped.
+ * @param copy_back: If not NULL, the area of `from` to update to `to` on the drawn lines.
+ * @returns `EPD_DRAW_SUCCESS` on sucess, a combination of error flags otherwise.
+ *      `EPD_DRAW_LOOKUP_NOT_IMPLEMENTED` if the render method does not support it.
+ */
+enum EpdDrawError epd_draw_difference_base(
+    EpdRect area,
+    const uint8_t* to,
+    uint8_t* from,
+    EpdRect crop_to,
+    enum EpdDrawMode mode,
+    int temperature,
+    const bool* drawn_lines,
+    const uint8_t* drawn_columns,
+    const EpdWaveform* waveform,
+    const EpdTransitionHistogram* transitions,
+    const EpdRect* copy_back
+);
+
+/**
+ * Start drawing the difference of `to` and `from` in an area of the screen,
+ * concurrently with other update regions, and return without waiting for it.
+ *
+ * Each active region progresses through the frames of its own waveform mode,
+ * so for example a fast `MODE_DU` region can be started and completed repeatedly
+ * while a `MODE_GC16` image refresh elsewhere on the screen is still in progress.
+ * Regions join and leave the update at frame boundaries.
+ * All pixels of the area are driven, and `from` is updated to `to` in the area
+ * once its last frame was drawn.
+ *
+ * While the region is active, its area of `to` and `from` must not be modified.
+ * Updates with `epd_draw_base()` wait until all regions are complete.
+ * The display must be powered on until then.
+ *
+ * @param area: The area of the screen to update, must not overlap an active region.
+ * @param to: The goal image as 4-bpp (`MODE_PACKING_2PPB`) framebuffer, 16 byte aligned.
+ * @param from: The previous image as 4-bpp (`MODE_PACKING_2PPB`) framebuffer, 16 byte aligned.
+ *      All active regions must use the same `to` and `from` framebuffers.
+ * @param mode: The waveform mode of the region.
+ * @param temperature: See `epd_draw_base()`.
+ * @param waveform: See `epd_draw_base()`.
+ * @param region: Set to the handle of the started region, for `epd_region_wait()`.
+ * @returns `EPD_DRAW_SUCCESS` if the region was started, a combination of error flags otherwise.
+ *      `EPD_DRAW_LOOKUP_NOT_IMPLEMENTED` if the render method or LUT size does not support it.
+ */
+enum EpdDrawError epd_region_start(
+    EpdRect area,
+    const uint8_t* to,
+    uint8_t* from,
+    enum EpdDrawMode mode,
+    int temperature,
+    const EpdWaveform* waveform,
+    int* region
+);
+
+/**
+ * Check if an update region started with `epd_region_start()` is complete.
+ */
+bool epd_region_done(int region);
+
+/**
+ * Wait until an update region started with `epd_region_start()` is complete.
+ * Every started region must be waited for, which frees it for new regions.
+ *
+ * @returns `EPD_DRAW_SUCCESS` on sucess, a combination of error flags
+ *      that occurred while the region was drawn otherwise.
+ */
+enum EpdDrawError epd_region_wait(int region);
+
+/// Number of updates kept by the performance counters, see `epd_get_update_stats()`.
+#define EPD_UPDATE_STATS_LEN 16
+
+/// Performance counters of an update drawn with `epd_draw_base()` or `epd_draw_difference_base()`.
+typedef struct {
+    /// Start of the update, see `esp_timer_get_time()`.
+    int64_t timestamp_us;
+    enum EpdDrawMode mode;
+    int temperature;
+    /// Time spent calculating difference images since the previous update.
+    uint32_t diff_us;
+    /// Time from the start to the end of the update.
+    uint32_t draw_us;
+    /// Number of waveform frames drawn.
+    int frames;
+    /// Number of waveform frames skipped, as they would not drive any pixel.
+    int skipped_frames;
+    /// Time the render threads spent preparing frames, summed over all threads.
+    uint32_t feed_us;
+    /// Longest preparation of a frame by a render thread.
+    uint32_t max_feed_us;
+    /// Time spent in the line output interrupt. Only measured by the LCD render method.
+    uint32_t isr_us;
+    /// Number of times a render thread waited for the display to consume lines.
+    uint32_t queue_stalls;
+    /// Number of line output interrupts that missed their deadline (LCD render method).
+    uint32_t underruns;
+    /// Bounding box of the drawn pixels, in display coordinates.
+    EpdRect dirty_area;
+    enum EpdDrawError error;
+} EpdUpdateStats;
+
+/**
+ * Get the performance counters of the most recent updates.
+ *
+ * @param stats: Filled with the counters, newest first.
+ * @param max_stats: Size of `stats`, at most `EPD_UPDATE_STATS_LEN` entries are filled.
+ * @returns The number of entries filled.
+ */
+int epd_get_update_stats(EpdUpdateStats* stats, int max_stats);
+
+/**
+ * Discard the performance counters of all previous updates.
+ */
+void epd_reset_update_stats();
+
+/**
+ * Like `epd_difference_image_cropped()` without an output image, for framebuffers
+ * of 2 or 1 bits per pixel. Bytes without changes are skipped at once.
+ * `dirty_lines` and `col_dirtyness` use the same 4 bit per pixel layout,
+ * so they can be passed to `epd_draw_base()` and `epd_draw_difference_base()` as is.
+ *
+ * @param format: Format of `to` and `from`.
+ * @param interlaced: If not NULL, the difference image of the lines of `crop_to`
+ *      is written to it, with one pixel per byte (`MODE_PACKING_1PPB_DIFFERENCE`).
+ * @param transitions: If not NULL, filled with the transitions of the drawn pixels,
+ *      like by `epd_difference_transitions()`.
+ * @returns The bounding box of the changed pixels within `crop_to`.
+ */
+EpdRect epd_difference_image_packed(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    enum EpdFramebufferFormat format,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness,
+    EpdTransitionHistogram* transitions
+);
+
+/**
+ * Like `epd_difference_copy_back()` for framebuffers of 2 or 1 bits per pixel.
+ * All pixels of `area` are copied on the dirty lines.
+ */
+void epd_difference_copy_back_packed(
+    const uint8_t* to,
+    uint8_t* from,
+    EpdRect area,
+    enum EpdFramebufferFormat format,
+    const bool* dirty_lines
+);
+
+/**
+ * Copy the changed pixels of `area` from `to` to `from`,
+ * so that `from` reflects the screen content after drawing the difference.
+ * Only the spans of dirty columns are copied on each dirty line.
+ *
+ * @param to: The goal image as 4-bpp (`MODE_PACKING_2PPB`) framebuffer.
+ * @param from: The previous image to update.
+ * @param area: The area to copy, usually the result of `epd_difference_image_cropped()`.
+ * @param dirty_lines: Lines to copy, as calculated by `epd_difference_image_cropped()`.
+ * @param col_dirtyness: Columns to copy, as calculated by `epd_difference_image_cropped()`.
+ */
+void epd_difference_copy_back(
+    const uint8_t* to,
+    uint8_t* from,
+    EpdRect area,
+    const bool* dirty_lines,
+    const uint8_t* col_dirtyness
+);
+
+/**
+ * Count the gray level transitions of all pixels that are driven
+ * when drawing the difference of `to` and `from`:
+ * Pixels in `crop_to` on dirty lines and in dirty columns, including unchanged ones.
+ *
+ * @param to: The goal image as 4-bpp (`MODE_PACKING_2PPB`) framebuffer.
+ * @param from: The previous image as 4-bpp (`MODE_PACKING_2PPB`) framebuffer.
+ * @param crop_to: The area to consider, usually the result of `epd_difference_image_cropped()`.
+ * @param dirty_lines: Dirty lines as calculated by `epd_difference_image_cropped()`.
+ * @param col_dirtyness: Column dirtyness as calculated by `epd_difference_image_cropped()`.
+ * @param histogram: The resulting transition histogram.
+ */
+void epd_difference_transitions(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    const bool* dirty_lines,
+    const uint8_t* col_dirtyness,
+    EpdTransitionHistogram* histogram
+);
+
 /**
  * Calculate a `MODE_PACKING_1PPB_DIFFERENCE` difference image
  * from two `MODE_PACKING_2PPB` (4 bit-per-pixel) buffers.
@@ -539,11 +816,13 @@ enum EpdDrawError epd_draw_base(
  * @param crop_to: Only calculate the difference for a crop of the input framebuffers.
  *      The `interlaced` will not be modified outside the crop area.
  * @param interlaced: The resulting difference image in `MODE_PACKING_1PPB_DIFFERENCE` format.
+ *      May be NULL to only calculate the dirtyness, e.g. for `epd_draw_difference_base()`.
  * @param dirty_lines: An array of at least `epd_height()`.
  *      The positions corresponding to lines where `to` and `from` differ
- *      are set to `true`, otherwise to `false`.
+ *      inside the crop area are set to `true`, otherwise to `false`.
  * @param col_dirtyness: An array of at least `epd_width() / 2`.
  *      If a nibble is set to non-zero, the pixel column is marked as changed, aka "dirty."
+ *      Columns outside of the crop area are never marked.
  *      The buffer must be 16 byte aligned.
  * @returns The smallest rectangle containing all changed pixels.
  */
@@ -570,6 +849,63 @@ EpdRect epd_difference_image(
     uint8_t* col_dirtiness
 );
 
+/**
+ * Like `epd_difference_image_cropped()` without an output image, but only
+ * considers the tiles marked in a dirty tile map (see `epd_track_dirty_tiles()`).
+ * Changes in tiles that are not marked are not detected.
+ *
+ * @param dirty_tiles: A dirty tile map covering the whole display.
+ */
+EpdRect epd_difference_image_tiles(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    const uint8_t* dirty_tiles,
+    bool* dirty_lines,
+    uint8_t* col_dirtiness
+);
+
+/// Edge length in pixels of the square tiles used for dirty tracking.
+#define EPD_DIRTY_TILE_SIZE 32
+
+/**
+ * Number of bytes of a dirty tile map, one per tile of the display,
+ * row by row in unrotated display coordinates.
+ */
+int epd_dirty_tile_count();
+
+/// Number of bytes per line of a display sized framebuffer in `format`.
+int epd_framebuffer_line_bytes(enum EpdFramebufferFormat format);
+
+/**
+ * Set the pixel format of a framebuffer for the drawing functions
+ * (`epd_draw_pixel()`, `epd_write_string()`, `epd_copy_to_framebuffer()`, ...).
+ * Colors are rounded to the nearest level of the format.
+ * Only one framebuffer can have a format other than `EPD_FB_4BPP`,
+ * setting another one resets the previous framebuffer.
+ */
+void epd_set_framebuffer_format(const uint8_t* framebuffer, enum EpdFramebufferFormat format);
+
+/**
+ * Record which tiles of a framebuffer are changed by the drawing functions.
+ *
+ * Only one framebuffer can be tracked at a time. The high-level API uses this
+ * to only compare changed tiles when updating the screen.
+ *
+ * @param framebuffer: The framebuffer to track, or NULL to stop tracking.
+ * @param tile_map: A buffer of `epd_dirty_tile_count()` bytes. The byte of
+ *      each tile a drawing function writes to is set to non-zero.
+ */
+void epd_track_dirty_tiles(const uint8_t* framebuffer, uint8_t* tile_map);
+
+/**
+ * Mark an area of a tracked framebuffer as changed, e.g. after writing to it directly.
+ * Does nothing if `framebuffer` is not tracked.
+ *
+ * @param area: The changed area in unrotated display coordinates.
+ */
+void epd_mark_dirty(const uint8_t* framebuffer, EpdRect area);
+
 /**
  * Return the pixel color of a 4 bit image array
  * x,y coordinates of the image pixel
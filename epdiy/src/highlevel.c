@@ -7,10 +7,12 @@
 #include <esp_log.h>
 #include <esp_timer.h>
 #include <esp_types.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "epd_highlevel.h"
 #include "epdiy.h"
+#include "output_common/render_method.h"
 
 #ifndef _swap_int
 #define _swap_int(a, b) \
@@ -21,15 +23,36 @@
     }
 #endif
 
+static inline int min(int x, int y) {
+    return x < y ? x : y;
+}
+static inline int max(int x, int y) {
+    return x > y ? x : y;
+}
+
 static bool already_initialized = 0;
 
+static inline int ghosting_tile_columns() {
+    return (epd_width() + EPD_HL_GHOSTING_TILE_SIZE - 1) / EPD_HL_GHOSTING_TILE_SIZE;
+}
+
+static inline int ghosting_tile_rows() {
+    return (epd_height() + EPD_HL_GHOSTING_TILE_SIZE - 1) / EPD_HL_GHOSTING_TILE_SIZE;
+}
+
 EpdiyHighlevelState epd_hl_init(const EpdWaveform* waveform) {
+    return epd_hl_init_format(waveform, EPD_FB_4BPP);
+}
+
+EpdiyHighlevelState epd_hl_init_format(
+    const EpdWaveform* waveform, enum EpdFramebufferFormat format
+) {
     assert(!already_initialized);
     if (waveform == NULL) {
         waveform = epd_get_display()->default_waveform;
     }
 
-    int fb_size = epd_width() / 2 * epd_height();
+    int fb_size = epd_framebuffer_line_bytes(format) * epd_height();
 
 #if !(defined(CONFIG_ESP32_SPIRAM_SUPPORT) || defined(CONFIG_ESP32S3_SPIRAM_SUPPORT))
     ESP_LOGW(
@@ -37,12 +60,34 @@ EpdiyHighlevelState epd_hl_init(const EpdWaveform* waveform) {
     );
 #endif
     EpdiyHighlevelState state;
+    state.format = format;
     state.back_fb = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_SPIRAM);
     assert(state.back_fb != NULL);
     state.front_fb = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_SPIRAM);
     assert(state.front_fb != NULL);
-    state.difference_fb = heap_caps_aligned_alloc(16, 2 * fb_size, MALLOC_CAP_SPIRAM);
-    assert(state.difference_fb != NULL);
+    if (format == EPD_FB_1BPP) {
+        // the pixels driven by each pass of an update
+        state.difference_fb = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_SPIRAM);
+        assert(state.difference_fb != NULL);
+    } else {
+#ifdef RENDER_METHOD_LCD
+        // the difference image is calculated line by line while drawing
+        state.difference_fb = NULL;
+#else
+        state.difference_fb
+            = heap_caps_aligned_alloc(16, epd_width() * epd_height(), MALLOC_CAP_SPIRAM);
+        assert(state.difference_fb != NULL);
+#endif
+    }
+    state.ghosting_counters = calloc(ghosting_tile_rows() * ghosting_tile_columns(), 1);
+    assert(state.ghosting_counters != NULL);
+    state.ghosting_threshold = 0;
+    state.dirty_tiles = malloc(epd_dirty_tile_count());
+    assert(state.dirty_tiles != NULL);
+    memset(state.dirty_tiles, 1, epd_dirty_tile_count());
+    state.track_dirty_tiles = false;
+    state.transitions = malloc(sizeof(EpdTransitionHistogram));
+    assert(state.transitions != NULL);
     state.dirty_lines = malloc(epd_height() * sizeof(bool));
     assert(state.dirty_lines != NULL);
     state.dirty_columns
@@ -52,6 +97,7 @@ EpdiyHighlevelState epd_hl_init(const EpdWaveform* waveform) {
 
     memset(state.front_fb, 0xFF, fb_size);
     memset(state.back_fb, 0xFF, fb_size);
+    epd_set_framebuffer_format(state.front_fb, format);
 
     already_initialized = true;
     return state;
@@ -102,83 +148,398 @@ EpdRect _inverse_rotated_area(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
     return rotated;
 }
 
-enum EpdDrawError epd_hl_update_area(
-    EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area
+static bool waveform_has_mode(const EpdWaveform* waveform, enum EpdDrawMode mode) {
+    for (int i = 0; i < waveform->num_modes; i++) {
+        if (waveform->mode_data[i]->type == mode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Bitmap of the gray levels 0x0, 0x5, 0xA and 0xF.
+#define FOUR_GRAY_LEVELS ((1 << 0x0) | (1 << 0x5) | (1 << 0xA) | (1 << 0xF))
+/// Bitmap of the gray levels 0x0 and 0xF.
+#define MONOCHROME_LEVELS ((1 << 0x0) | (1 << 0xF))
+
+/**
+ * Choose the fastest waveform mode that reaches all target levels
+ * of the transitions in `transitions`, based on the modes available in `waveform`.
+ */
+static enum EpdDrawMode select_auto_mode(
+    const EpdTransitionHistogram* transitions, const EpdWaveform* waveform
 ) {
-    assert(state != NULL);
-    // Not right to rotate here since this copies part of buffer directly
+    // gray levels of changed pixels after the update
+    uint16_t targets = 0;
+    // gray levels of all drawn pixels, before and after the update
+    uint16_t levels = 0;
+    for (int t = 0; t < 256; t++) {
+        if (transitions->counts[t] == 0) {
+            continue;
+        }
+        int to = t >> 4;
+        int from = t & 0xF;
+        if (to != from) {
+            targets |= 1 << to;
+        }
+        levels |= (1 << to) | (1 << from);
+    }
 
-    // Check rotation FIX
-    EpdRect rotated_area = _inverse_rotated_area(area.x, area.y, area.width, area.height);
-    area.x = rotated_area.x;
-    area.y = rotated_area.y;
-    area.width = rotated_area.width;
-    area.height = rotated_area.height;
+    if ((levels & ~MONOCHROME_LEVELS) == 0 && waveform_has_mode(waveform, MODE_A2)) {
+        return MODE_A2;
+    }
+    if ((targets & ~MONOCHROME_LEVELS) == 0 && waveform_has_mode(waveform, MODE_DU)) {
+        return MODE_DU;
+    }
+    if ((targets & ~FOUR_GRAY_LEVELS) == 0 && waveform_has_mode(waveform, MODE_DU4)) {
+        return MODE_DU4;
+    }
+    if ((levels & ~FOUR_GRAY_LEVELS) == 0 && waveform_has_mode(waveform, MODE_GL4)) {
+        return MODE_GL4;
+    }
+    return MODE_GC16;
+}
 
-    uint32_t ts = esp_timer_get_time() / 1000;
+/**
+ * Count a fast update for every tile containing driven pixels,
+ * or reset the counters of a forced GC16 refresh.
+ * The driven pixels are given by the dirty lines and columns of the update.
+ */
+static void update_ghosting_counters(
+    EpdiyHighlevelState* state,
+    enum EpdDrawMode mode,
+    EpdRect diff_area,
+    const bool* dirty_lines,
+    const uint8_t* dirty_columns,
+    bool forced
+) {
+    const int tile = EPD_HL_GHOSTING_TILE_SIZE;
+    int tile_cols = ghosting_tile_columns();
+
+    for (int ty = diff_area.y / tile; ty <= (diff_area.y + diff_area.height - 1) / tile; ty++) {
+        bool row_driven = false;
+        int y_end = min((ty + 1) * tile, diff_area.y + diff_area.height);
+        for (int y = max(ty * tile, diff_area.y); y < y_end && !row_driven; y++) {
+            row_driven = dirty_lines[y];
+        }
+        if (!row_driven) {
+            continue;
+        }
+
+        for (int tx = diff_area.x / tile; tx <= (diff_area.x + diff_area.width - 1) / tile; tx++) {
+            bool col_driven = false;
+            int x_end = min((tx + 1) * tile, diff_area.x + diff_area.width);
+            for (int x = max(tx * tile, diff_area.x) / 2; x < (x_end + 1) / 2 && !col_driven; x++) {
+                col_driven = dirty_columns[x] != 0;
+            }
+            if (!col_driven) {
+                continue;
+            }
+
+            uint8_t* counter = &state->ghosting_counters[ty * tile_cols + tx];
+            if (forced && (mode == MODE_GC16 || mode == MODE_GC16_FAST)) {
+                *counter = 0;
+            } else if (mode != MODE_GC16 && mode != MODE_GC16_FAST && *counter < UINT8_MAX) {
+                *counter += 1;
+            }
+        }
+    }
+}
+
+/// Clear the dirty marks of the tiles completely inside a physical (non-rotated) area.
+static void clear_dirty_tiles(EpdiyHighlevelState* state, EpdRect area) {
+    const int tile = EPD_DIRTY_TILE_SIZE;
+    int tile_cols = (epd_width() + tile - 1) / tile;
+    int tile_rows = (epd_height() + tile - 1) / tile;
+
+    int x_end = min(area.x + area.width, epd_width());
+    int y_end = min(area.y + area.height, epd_height());
+    // partial tiles at the display edges count as complete
+    int tx_first = (max(area.x, 0) + tile - 1) / tile;
+    int ty_first = (max(area.y, 0) + tile - 1) / tile;
+    int tx_last = x_end == epd_width() ? tile_cols - 1 : x_end / tile - 1;
+    int ty_last = y_end == epd_height() ? tile_rows - 1 : y_end / tile - 1;
+
+    for (int ty = ty_first; ty <= ty_last && tx_first <= tx_last; ty++) {
+        memset(state->dirty_tiles + ty * tile_cols + tx_first, 0, tx_last - tx_first + 1);
+    }
+}
 
-    // FIXME: use crop information here, if available
-    EpdRect diff_area = epd_difference_image_cropped(
+/// Mark all lines and columns of a physical area as dirty, returning the area on the screen.
+static EpdRect mark_area_driven(EpdiyHighlevelState* state, EpdRect area) {
+    int x_start = max(area.x, 0);
+    int x_end = min(area.x + area.width, epd_width());
+    int y_start = max(area.y, 0);
+    int y_end = min(area.y + area.height, epd_height());
+    for (int y = y_start; y < y_end; y++) {
+        state->dirty_lines[y] = true;
+    }
+    for (int x = x_start; x < x_end; x++) {
+        state->dirty_columns[x / 2] |= x % 2 ? 0xF0 : 0x0F;
+    }
+    EpdRect driven = {
+        .x = x_start,
+        .y = y_start,
+        .width = max(x_end - x_start, 0),
+        .height = max(y_end - y_start, 0),
+    };
+    return driven;
+}
+
+/**
+ * Drive the pixels of a band of a 1 bit per pixel update in two passes with
+ * `MODE_PACKING_8PPB` data, first the pixels turning black, then those turning white.
+ * With `force`, all pixels on the dirty lines and columns are driven to their color.
+ */
+static enum EpdDrawError draw_monochrome_passes(
+    EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect band, bool force
+) {
+    int line_bytes = epd_framebuffer_line_bytes(EPD_FB_1BPP);
+    enum EpdDrawError err = EPD_DRAW_SUCCESS;
+    for (int pass = 0; pass < 2; pass++) {
+        bool darken = pass == 0;
+        // a cleared bit is driven black from white, a set bit white from black
+        uint8_t neutral = darken ? 0xFF : 0x00;
+        bool driven = false;
+        for (int y = band.y; y < band.y + band.height; y++) {
+            if (!state->dirty_lines[y]) {
+                continue;
+            }
+            const uint8_t* to = state->front_fb + y * line_bytes;
+            const uint8_t* from = state->back_fb + y * line_bytes;
+            uint8_t* layer = state->difference_fb + y * line_bytes;
+            for (int b = 0; b < line_bytes; b++) {
+                if (force) {
+                    layer[b] = to[b];
+                } else {
+                    layer[b] = darken ? ~from[b] | to[b] : ~from[b] & to[b];
+                }
+                driven |= layer[b] != neutral;
+            }
+        }
+        if (!driven) {
+            continue;
+        }
+        err |= epd_draw_base(
+            epd_full_screen(),
+            state->difference_fb,
+            band,
+            mode | MODE_PACKING_8PPB | (darken ? PREVIOUSLY_WHITE : PREVIOUSLY_BLACK),
+            temperature,
+            state->dirty_lines,
+            state->dirty_columns,
+            state->waveform
+        );
+    }
+    return err;
+}
+
+/**
+ * Like `update_physical_area()`, for framebuffers of 2 or 1 bits per pixel.
+ */
+static enum EpdDrawError update_packed_area(
+    EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area, bool force
+) {
+    // the difference image is only stored for 2 bits per pixel without the LCD render method
+    uint8_t* interlaced = state->format == EPD_FB_2BPP ? state->difference_fb : NULL;
+    EpdRect diff_area = epd_difference_image_packed(
         state->front_fb,
         state->back_fb,
         area,
-        state->difference_fb,
+        state->format,
+        interlaced,
         state->dirty_lines,
-        state->dirty_columns
+        state->dirty_columns,
+        state->transitions
     );
+    if (state->track_dirty_tiles) {
+        clear_dirty_tiles(state, area);
+    }
+    // Unchanged pixels are not counted in the transitions,
+    // so no frames may be skipped when they are driven.
+    const EpdTransitionHistogram* transitions = state->transitions;
+    if (force) {
+        diff_area = mark_area_driven(state, area);
+        transitions = NULL;
+    }
 
     if (diff_area.height == 0 || diff_area.width == 0) {
         return EPD_DRAW_SUCCESS;
     }
 
-    uint32_t t1 = esp_timer_get_time() / 1000;
+    EpdRect draw_band = {
+        .x = 0,
+        .y = diff_area.y,
+        .width = epd_width(),
+        .height = diff_area.height,
+    };
+
+    if (mode == MODE_AUTO) {
+        mode = select_auto_mode(state->transitions, state->waveform);
+        ESP_LOGI("epdiy", "automatic mode selection: %d", mode);
+    }
 
-    diff_area.x = 0;
-    diff_area.y = 0;
-    diff_area.width = epd_width();
-    diff_area.height = epd_height();
+    update_ghosting_counters(
+        state, mode, diff_area, state->dirty_lines, state->dirty_columns, force
+    );
 
     enum EpdDrawError err = EPD_DRAW_SUCCESS;
-    err = epd_draw_base(
-        epd_full_screen(),
-        state->difference_fb,
+    if (state->format == EPD_FB_1BPP) {
+        err = draw_monochrome_passes(state, mode, temperature, draw_band, force);
+    } else if (state->difference_fb == NULL) {
+        err = epd_draw_difference_base(
+            epd_full_screen(),
+            state->front_fb,
+            state->back_fb,
+            draw_band,
+            mode | MODE_PACKING_4PPB,
+            temperature,
+            state->dirty_lines,
+            state->dirty_columns,
+            state->waveform,
+            transitions,
+            &diff_area
+        );
+    } else {
+        err = epd_draw_base(
+            epd_full_screen(),
+            state->difference_fb,
+            draw_band,
+            MODE_PACKING_1PPB_DIFFERENCE | mode,
+            temperature,
+            state->dirty_lines,
+            state->dirty_columns,
+            state->waveform
+        );
+    }
+
+    // With the difference calculated while drawing, this already happened in the last frame.
+    if (state->difference_fb != NULL) {
+        epd_difference_copy_back_packed(
+            state->front_fb, state->back_fb, diff_area, state->format, state->dirty_lines
+        );
+    }
+    return err;
+}
+
+/**
+ * Update a physical (non-rotated) area of the screen.
+ * If `force` is set, all pixels of the area are driven, even unchanged ones.
+ */
+static enum EpdDrawError update_physical_area(
+    EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area, bool force
+) {
+    if (state->format != EPD_FB_4BPP) {
+        return update_packed_area(state, mode, temperature, area, force);
+    }
+
+    uint32_t ts = esp_timer_get_time() / 1000;
+
+    EpdRect diff_area;
+    if (state->track_dirty_tiles && state->difference_fb == NULL && !force) {
+        diff_area = epd_difference_image_tiles(
+            state->front_fb,
+            state->back_fb,
+            area,
+            state->dirty_tiles,
+            state->dirty_lines,
+            state->dirty_columns
+        );
+    } else {
+        diff_area = epd_difference_image_cropped(
+            state->front_fb,
+            state->back_fb,
+            area,
+            state->difference_fb,
+            state->dirty_lines,
+            state->dirty_columns
+        );
+    }
+    if (state->track_dirty_tiles) {
+        clear_dirty_tiles(state, area);
+    }
+
+    if (force) {
+        diff_area = mark_area_driven(state, area);
+    }
+
+    if (diff_area.height == 0 || diff_area.width == 0) {
+        return EPD_DRAW_SUCCESS;
+    }
+
+    uint32_t t1 = esp_timer_get_time() / 1000;
+
+    // Only the row band of the changed area is driven.
+    // Columns outside of it are masked by the column dirtyness when drawing
+    // the difference directly, the difference image is cropped to them instead.
+    EpdRect draw_band = {
+        .x = 0,
+        .y = diff_area.y,
+        .width = epd_width(),
+        .height = diff_area.height,
+    };
+    if (state->difference_fb != NULL) {
+        draw_band.x = diff_area.x;
+        draw_band.width = diff_area.width;
+    }
+
+    // The transitions present select the automatic mode,
+    // and frames that do not drive any of them are skipped.
+    epd_difference_transitions(
+        state->front_fb,
+        state->back_fb,
         diff_area,
-        MODE_PACKING_1PPB_DIFFERENCE | mode,
-        temperature,
         state->dirty_lines,
         state->dirty_columns,
-        state->waveform
+        state->transitions
     );
 
-    uint32_t t2 = esp_timer_get_time() / 1000;
-
-    diff_area.x = 0;
-    diff_area.y = 0;
-    diff_area.width = epd_width();
-    diff_area.height = epd_height();
-
-    int buf_width = epd_width();
-
-    for (int l = diff_area.y; l < diff_area.y + diff_area.height; l++) {
-        if (state->dirty_lines[l] > 0) {
-            uint8_t* lfb = state->front_fb + buf_width / 2 * l;
-            uint8_t* lbb = state->back_fb + buf_width / 2 * l;
+    if (mode == MODE_AUTO) {
+        mode = select_auto_mode(state->transitions, state->waveform);
+        ESP_LOGI("epdiy", "automatic mode selection: %d", mode);
+    }
 
-            int x = diff_area.x;
-            int x_last = diff_area.x + diff_area.width - 1;
+    update_ghosting_counters(
+        state, mode, diff_area, state->dirty_lines, state->dirty_columns, force
+    );
 
-            if (x % 2) {
-                *(lbb + x / 2) = (*(lfb + x / 2) & 0xF0) | (*(lbb + x / 2) & 0x0F);
-                x += 1;
-            }
+    enum EpdDrawError err = EPD_DRAW_SUCCESS;
+    if (state->difference_fb == NULL) {
+        err = epd_draw_difference_base(
+            epd_full_screen(),
+            state->front_fb,
+            state->back_fb,
+            draw_band,
+            mode,
+            temperature,
+            state->dirty_lines,
+            state->dirty_columns,
+            state->waveform,
+            state->transitions,
+            &diff_area
+        );
+    } else {
+        err = epd_draw_base(
+            epd_full_screen(),
+            state->difference_fb,
+            draw_band,
+            MODE_PACKING_1PPB_DIFFERENCE | mode,
+            temperature,
+            state->dirty_lines,
+            state->dirty_columns,
+            state->waveform
+        );
+    }
 
-            if (!(x_last % 2)) {
-                *(lbb + x_last / 2) = (*(lfb + x_last / 2) & 0x0F) | (*(lbb + x_last / 2) & 0xF0);
-                x_last -= 1;
-            }
+    uint32_t t2 = esp_timer_get_time() / 1000;
 
-            memcpy(lbb + (x / 2), lfb + (x / 2), (x_last - x + 1) / 2);
-        }
+    // Only copy back the changed area, the rest of the front buffer
+    // may contain changes outside of the update area.
+    // With the difference calculated while drawing, this already happened in the last frame.
+    if (state->difference_fb != NULL) {
+        epd_difference_copy_back(
+            state->front_fb, state->back_fb, diff_area, state->dirty_lines, state->dirty_columns
+        );
     }
 
     uint32_t t3 = esp_timer_get_time() / 1000;
@@ -194,10 +555,227 @@ enum EpdDrawError epd_hl_update_area(
     return err;
 }
 
+enum EpdDrawError epd_hl_update_area(
+    EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area
+) {
+    assert(state != NULL);
+    // Not right to rotate here since this copies part of buffer directly
+
+    // Check rotation FIX
+    EpdRect rotated_area = _inverse_rotated_area(area.x, area.y, area.width, area.height);
+    return update_physical_area(state, mode, temperature, rotated_area, false);
+}
+
+enum EpdDrawError epd_hl_update_area_async(
+    EpdiyHighlevelState* state, enum EpdDrawMode mode, int temperature, EpdRect area, int* region
+) {
+    assert(state != NULL);
+
+    if (state->format != EPD_FB_4BPP) {
+        return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
+    }
+
+    EpdRect rotated_area = _inverse_rotated_area(area.x, area.y, area.width, area.height);
+
+    // The changed pixels of fast updates are counted for the ghosting cleanup.
+    // Regions started before may still be running, so the difference goes
+    // into buffers of this call instead of the ones of the state.
+    bool* dirty_lines = NULL;
+    uint8_t* dirty_columns = NULL;
+    EpdRect diff_area = rotated_area;
+    if (mode != MODE_GC16 && mode != MODE_GC16_FAST) {
+        dirty_lines = malloc(epd_height() * sizeof(bool));
+        assert(dirty_lines != NULL);
+        dirty_columns
+            = heap_caps_aligned_alloc(16, epd_width() / 2, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        assert(dirty_columns != NULL);
+        diff_area = epd_difference_image_cropped(
+            state->front_fb, state->back_fb, rotated_area, NULL, dirty_lines, dirty_columns
+        );
+    }
+
+    if (mode == MODE_AUTO) {
+        EpdTransitionHistogram* transitions = malloc(sizeof(EpdTransitionHistogram));
+        assert(transitions != NULL);
+        epd_difference_transitions(
+            state->front_fb, state->back_fb, diff_area, dirty_lines, dirty_columns, transitions
+        );
+        mode = select_auto_mode(transitions, state->waveform);
+        ESP_LOGI("epdiy", "automatic mode selection: %d", mode);
+        free(transitions);
+    }
+
+    enum EpdDrawError err = epd_region_start(
+        rotated_area, state->front_fb, state->back_fb, mode, temperature, state->waveform, region
+    );
+    if (err == EPD_DRAW_SUCCESS && state->track_dirty_tiles) {
+        clear_dirty_tiles(state, rotated_area);
+    }
+    if (err == EPD_DRAW_SUCCESS && dirty_lines != NULL && diff_area.height > 0) {
+        update_ghosting_counters(state, mode, diff_area, dirty_lines, dirty_columns, false);
+    }
+    free(dirty_lines);
+    heap_caps_free(dirty_columns);
+    return err;
+}
+
+void epd_hl_set_ghosting_threshold(EpdiyHighlevelState* state, int threshold) {
+    assert(state != NULL);
+    state->ghosting_threshold = threshold;
+}
+
+enum EpdDrawError epd_hl_clean_ghosting(EpdiyHighlevelState* state, int temperature) {
+    assert(state != NULL);
+    if (state->ghosting_threshold <= 0) {
+        return EPD_DRAW_SUCCESS;
+    }
+
+    const int tile = EPD_HL_GHOSTING_TILE_SIZE;
+    int tile_cols = ghosting_tile_columns();
+    enum EpdDrawError err = EPD_DRAW_SUCCESS;
+
+    // One pass per row of tiles, since all driven columns are driven on all driven lines.
+    for (int ty = 0; ty < ghosting_tile_rows(); ty++) {
+        int first = -1;
+        int last = -1;
+        for (int tx = 0; tx < tile_cols; tx++) {
+            if (state->ghosting_counters[ty * tile_cols + tx] >= state->ghosting_threshold) {
+                if (first < 0) {
+                    first = tx;
+                }
+                last = tx;
+            }
+        }
+        if (first < 0) {
+            continue;
+        }
+
+        EpdRect area = {
+            .x = first * tile,
+            .y = ty * tile,
+            .width = (last - first + 1) * tile,
+            .height = tile,
+        };
+        ESP_LOGI("epdiy", "cleaning ghosting in tiles %d-%d of row %d", first, last, ty);
+        err |= update_physical_area(state, MODE_GC16, temperature, area, true);
+    }
+    return err;
+}
+
+void epd_hl_set_dirty_tracking(EpdiyHighlevelState* state, bool enable) {
+    assert(state != NULL);
+    // changes made while not tracking are unknown
+    memset(state->dirty_tiles, 1, epd_dirty_tile_count());
+    state->track_dirty_tiles = enable;
+    epd_track_dirty_tiles(enable ? state->front_fb : NULL, state->dirty_tiles);
+}
+
+void epd_hl_mark_dirty(EpdiyHighlevelState* state, EpdRect area) {
+    assert(state != NULL);
+    EpdRect rotated_area = _inverse_rotated_area(area.x, area.y, area.width, area.height);
+    epd_mark_dirty(state->front_fb, rotated_area);
+}
+
+void epd_hl_clear_dirty(EpdiyHighlevelState* state, EpdRect area) {
+    assert(state != NULL);
+    EpdRect rotated_area = _inverse_rotated_area(area.x, area.y, area.width, area.height);
+    clear_dirty_tiles(state, rotated_area);
+}
+
+/// Move the pixels of a physical area `dy` rows down with a copy per row.
+static void shift_rows(EpdiyHighlevelState* state, EpdRect area, int dy) {
+    int line_bytes = epd_framebuffer_line_bytes(state->format);
+    int per_byte = epd_width() / line_bytes;
+    int bits = 8 / per_byte;
+    int end = area.x + area.width;
+    int first = area.x / per_byte;
+    int last = (end - 1) / per_byte;
+    // pixels of the area in the partially covered bytes at both ends
+    uint8_t first_mask = 0xFF << (bits * (area.x % per_byte));
+    uint8_t last_mask = 0xFF >> (bits * ((per_byte - end % per_byte) % per_byte));
+    if (first == last) {
+        first_mask &= last_mask;
+    }
+
+    for (int i = 0; i < area.height - abs(dy); i++) {
+        // copy the rows furthest in the direction of movement first,
+        // so no source row is overwritten before it is moved
+        int y = dy > 0 ? area.y + area.height - 1 - i : area.y + i;
+        uint8_t* dst = state->front_fb + y * line_bytes;
+        const uint8_t* src = state->front_fb + (y - dy) * line_bytes;
+        dst[first] = (dst[first] & ~first_mask) | (src[first] & first_mask);
+        if (last > first) {
+            memcpy(dst + first + 1, src + first + 1, last - first - 1);
+            dst[last] = (dst[last] & ~last_mask) | (src[last] & last_mask);
+        }
+    }
+}
+
+/// Move the pixels of a physical area `dx` columns right, pixel by pixel.
+static void shift_columns(EpdiyHighlevelState* state, EpdRect area, int dx) {
+    int line_bytes = epd_framebuffer_line_bytes(state->format);
+    int bits = 8 * line_bytes / epd_width();
+    uint8_t value_mask = (1 << bits) - 1;
+
+    for (int y = area.y; y < area.y + area.height; y++) {
+        uint8_t* line = state->front_fb + y * line_bytes;
+        for (int i = 0; i < area.width - abs(dx); i++) {
+            int x = dx > 0 ? area.x + area.width - 1 - i : area.x + i;
+            int src = (x - dx) * bits;
+            int dst = x * bits;
+            uint8_t value = (line[src / 8] >> (src % 8)) & value_mask;
+            line[dst / 8] = (line[dst / 8] & ~(value_mask << (dst % 8))) | (value << (dst % 8));
+        }
+    }
+}
+
+EpdRect epd_hl_scroll(EpdiyHighlevelState* state, EpdRect area, int dy) {
+    assert(state != NULL);
+    int x = max(area.x, 0);
+    int y = max(area.y, 0);
+    area.width = min(area.x + area.width, epd_rotated_display_width()) - x;
+    area.height = min(area.y + area.height, epd_rotated_display_height()) - y;
+    area.x = x;
+    area.y = y;
+
+    EpdRect exposed = area;
+    if (area.width <= 0 || area.height <= 0) {
+        exposed.width = exposed.height = 0;
+        return exposed;
+    }
+    exposed.height = min(abs(dy), area.height);
+    if (dy < 0) {
+        exposed.y = area.y + area.height - exposed.height;
+    }
+    if (dy == 0 || exposed.height == area.height) {
+        return exposed;
+    }
+
+    EpdRect physical = _inverse_rotated_area(area.x, area.y, area.width, area.height);
+    // in portrait orientations, the rows of the rotated display are physical columns
+    switch (epd_get_rotation()) {
+        case EPD_ROT_LANDSCAPE:
+            shift_rows(state, physical, dy);
+            break;
+        case EPD_ROT_INVERTED_LANDSCAPE:
+            shift_rows(state, physical, -dy);
+            break;
+        case EPD_ROT_PORTRAIT:
+            shift_columns(state, physical, -dy);
+            break;
+        case EPD_ROT_INVERTED_PORTRAIT:
+            shift_columns(state, physical, dy);
+            break;
+    }
+    epd_mark_dirty(state->front_fb, physical);
+    return exposed;
+}
+
 void epd_hl_set_all_white(EpdiyHighlevelState* state) {
     assert(state != NULL);
-    int fb_size = epd_width() / 2 * epd_height();
+    int fb_size = epd_framebuffer_line_bytes(state->format) * epd_height();
     memset(state->front_fb, 0xFF, fb_size);
+    memset(state->dirty_tiles, 1, epd_dirty_tile_count());
 }
 
 void epd_fullclear(EpdiyHighlevelState* state, int temperature) {
@@ -206,6 +784,7 @@ void epd_fullclear(EpdiyHighlevelState* state, int temperature) {
     enum EpdDrawError err = epd_hl_update_screen(state, MODE_GC16, temperature);
     assert(err == EPD_DRAW_SUCCESS);
     epd_clear();
+    memset(state->ghosting_counters, 0, ghosting_tile_rows() * ghosting_tile_columns());
 }
 
 void epd_hl_waveform(EpdiyHighlevelState* state, const EpdWaveform* waveform) {
@@ -213,4 +792,293 @@ void epd_hl_waveform(EpdiyHighlevelState* state, const EpdWaveform* waveform) {
         waveform = epd_get_display()->default_waveform;
     }
     state->waveform = waveform;
-}
\ No newline at end of file
+}
+EpdRefreshScheduler epd_hl_scheduler_init(int merge_distance, int interval_ms) {
+    EpdRefreshScheduler sched = {
+        .num_pending = 0,
+        .merge_distance = merge_distance,
+        .interval_ms = interval_ms,
+        .last_flush_us = 0,
+    };
+    return sched;
+}
+
+static bool areas_near(EpdRect a, EpdRect b, int distance) {
+    return a.x - distance < b.x + b.width && b.x - distance < a.x + a.width
+           && a.y - distance < b.y + b.height && b.y - distance < a.y + a.height;
+}
+
+static EpdRect area_union(EpdRect a, EpdRect b) {
+    int x_end = max(a.x + a.width, b.x + b.width);
+    int y_end = max(a.y + a.height, b.y + b.height);
+    EpdRect u = {
+        .x = min(a.x, b.x),
+        .y = min(a.y, b.y),
+    };
+    u.width = x_end - u.x;
+    u.height = y_end - u.y;
+    return u;
+}
+
+static void remove_pending(EpdRefreshScheduler* sched, int index) {
+    sched->num_pending--;
+    // keep the order, overlapping areas with different modes depend on it
+    memmove(
+        &sched->pending[index],
+        &sched->pending[index + 1],
+        (sched->num_pending - index) * sizeof(EpdPendingArea)
+    );
+}
+
+bool epd_hl_invalidate(EpdRefreshScheduler* sched, EpdRect area, enum EpdDrawMode mode) {
+    assert(sched != NULL);
+    if (area.width <= 0 || area.height <= 0) {
+        return true;
+    }
+
+    int target = -1;
+    for (int i = 0; i < sched->num_pending; i++) {
+        EpdPendingArea* p = &sched->pending[i];
+        if (p->mode == mode && areas_near(p->area, area, sched->merge_distance)) {
+            p->area = area_union(p->area, area);
+            target = i;
+            break;
+        }
+    }
+
+    if (target < 0) {
+        if (sched->num_pending >= EPD_HL_MAX_PENDING_AREAS) {
+            return false;
+        }
+        EpdPendingArea p = { .area = area, .mode = mode };
+        sched->pending[sched->num_pending++] = p;
+        return true;
+    }
+
+    // The grown area may now reach other pending areas.
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < sched->num_pending; i++) {
+            EpdPendingArea* p = &sched->pending[i];
+            EpdPendingArea* t = &sched->pending[target];
+            if (i == target || p->mode != t->mode
+                || !areas_near(p->area, t->area, sched->merge_distance)) {
+                continue;
+            }
+            // keep the merged area at the earlier position
+            int keep = min(i, target);
+            int drop = max(i, target);
+            sched->pending[keep].area = area_union(p->area, t->area);
+            remove_pending(sched, drop);
+            target = keep;
+            merged = true;
+            break;
+        }
+    }
+    return true;
+}
+
+bool epd_hl_scheduler_due(const EpdRefreshScheduler* sched) {
+    assert(sched != NULL);
+    if (sched->num_pending == 0) {
+        return false;
+    }
+    return esp_timer_get_time() - sched->last_flush_us >= (int64_t)sched->interval_ms * 1000;
+}
+
+EpdRefreshScheduler epd_hl_scheduler_take(EpdRefreshScheduler* sched) {
+    assert(sched != NULL);
+    EpdRefreshScheduler taken = *sched;
+    sched->num_pending = 0;
+    sched->last_flush_us = esp_timer_get_time();
+    return taken;
+}
+
+enum EpdDrawError epd_hl_flush(
+    EpdRefreshScheduler* sched, EpdiyHighlevelState* state, int temperature
+) {
+    assert(sched != NULL);
+    enum EpdDrawError err = EPD_DRAW_SUCCESS;
+    for (int i = 0; i < sched->num_pending; i++) {
+        err |= epd_hl_update_area(state, sched->pending[i].mode, temperature, sched->pending[i].area);
+    }
+    err |= epd_hl_clean_ghosting(state, temperature);
+    sched->num_pending = 0;
+    sched->last_flush_us = esp_timer_get_time();
+    return err;
+}
+
+///////////////////////////// Ink Sessions ///////////////////////////////
+
+EpdInkState epd_hl_ink_begin(EpdiyHighlevelState* state) {
+    assert(state != NULL);
+    EpdInkState ink;
+    ink.hl = state;
+    ink.layer = heap_caps_aligned_alloc(16, epd_width() / 8 * epd_height(), MALLOC_CAP_SPIRAM);
+    assert(ink.layer != NULL);
+    memset(ink.layer, 0xFF, epd_width() / 8 * epd_height());
+    ink.mode = waveform_has_mode(state->waveform, MODE_A2) ? MODE_A2 : MODE_DU;
+    ink.queue_head = 0;
+    ink.queue_tail = 0;
+
+    epd_poweron();
+    return ink;
+}
+
+bool epd_hl_ink_add(EpdInkState* ink, EpdInkSegment segment) {
+    assert(ink != NULL);
+    assert(segment.width > 0);
+    int head = __atomic_load_n(&ink->queue_head, __ATOMIC_RELAXED);
+    int tail = __atomic_load_n(&ink->queue_tail, __ATOMIC_ACQUIRE);
+    int next = (head + 1) % EPD_HL_INK_QUEUE_LENGTH;
+    if (next == tail) {
+        return false;
+    }
+    ink->queue[head] = segment;
+    __atomic_store_n(&ink->queue_head, next, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Draw a segment into a framebuffer, with a round brush for wide strokes.
+ * Returns the bounding box of the segment, in rotated coordinates.
+ */
+static EpdRect draw_ink_segment(const EpdInkSegment* seg, uint8_t* fb) {
+    int r = seg->width / 2;
+    int x0 = seg->x0, y0 = seg->y0;
+    int x1 = seg->x1, y1 = seg->y1;
+    EpdRect bounds = {
+        .x = min(x0, x1) - r,
+        .y = min(y0, y1) - r,
+        .width = abs(x1 - x0) + 2 * r + 1,
+        .height = abs(y1 - y0) + 2 * r + 1,
+    };
+
+    if (r == 0) {
+        epd_draw_line(x0, y0, x1, y1, 0x00, fb);
+        return bounds;
+    }
+
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    while (true) {
+        epd_fill_circle(x0, y0, r, 0x00, fb);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+    return bounds;
+}
+
+enum EpdDrawError epd_hl_ink_flush(EpdInkState* ink, int temperature) {
+    assert(ink != NULL);
+    EpdiyHighlevelState* state = ink->hl;
+
+    int tail = __atomic_load_n(&ink->queue_tail, __ATOMIC_RELAXED);
+    int head = __atomic_load_n(&ink->queue_head, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return EPD_DRAW_SUCCESS;
+    }
+
+    // Rasterize the new segments into the ink layer, which the drawing functions
+    // treat as 1 bit per pixel meanwhile, and into the front framebuffer.
+    // Bounding box of all new segments, in rotated coordinates.
+    EpdRect bounds = { 0 };
+    epd_set_framebuffer_format(ink->layer, EPD_FB_1BPP);
+    for (int i = tail; i != head; i = (i + 1) % EPD_HL_INK_QUEUE_LENGTH) {
+        EpdRect seg_bounds = draw_ink_segment(&ink->queue[i], ink->layer);
+        bounds = bounds.width > 0 ? area_union(bounds, seg_bounds) : seg_bounds;
+    }
+    epd_set_framebuffer_format(ink->layer, EPD_FB_4BPP);
+    epd_set_framebuffer_format(state->front_fb, state->format);
+    for (; tail != head; tail = (tail + 1) % EPD_HL_INK_QUEUE_LENGTH) {
+        draw_ink_segment(&ink->queue[tail], state->front_fb);
+    }
+    __atomic_store_n(&ink->queue_tail, tail, __ATOMIC_RELEASE);
+
+    EpdRect area = _inverse_rotated_area(bounds.x, bounds.y, bounds.width, bounds.height);
+    int x_start = max(area.x, 0);
+    int x_end = min(area.x + area.width, epd_width());
+    int y_start = max(area.y, 0);
+    int y_end = min(area.y + area.height, epd_height());
+    if (x_end <= x_start || y_end <= y_start) {
+        return EPD_DRAW_SUCCESS;
+    }
+
+    // Only the stroke pixels are inked and recorded as black in the back buffer,
+    // other changes of the front framebuffer are left to a regular update.
+    // Pixels already black on the display are not driven again.
+    int fb_line = epd_framebuffer_line_bytes(state->format);
+    int bits = 8 / (epd_width() / fb_line);
+    uint8_t pixel_mask = (1 << bits) - 1;
+    int layer_line = epd_width() / 8;
+    for (int y = y_start; y < y_end; y++) {
+        uint8_t* back = state->back_fb + y * fb_line;
+        uint8_t* layer = ink->layer + y * layer_line;
+        for (int x = x_start; x < x_end; x++) {
+            uint8_t layer_bit = 1 << (x % 8);
+            if (layer[x / 8] & layer_bit) {
+                continue;
+            }
+            int byte = x * bits / 8;
+            int shift = (x * bits) % 8;
+            if (((back[byte] >> shift) & pixel_mask) == 0) {
+                layer[x / 8] |= layer_bit;
+            } else {
+                back[byte] &= ~(pixel_mask << shift);
+            }
+        }
+    }
+
+    EpdRect band = {
+        .x = 0,
+        .y = y_start,
+        .width = epd_width(),
+        .height = y_end - y_start,
+    };
+    enum EpdDrawError err = epd_draw_base(
+        epd_full_screen(),
+        ink->layer,
+        band,
+        ink->mode | MODE_PACKING_8PPB | PREVIOUSLY_WHITE,
+        temperature,
+        NULL,
+        NULL,
+        state->waveform
+    );
+    memset(ink->layer + y_start * layer_line, 0xFF, band.height * layer_line);
+
+    // inked tiles count towards ghosting like other fast updates
+    EpdRect inked = { x_start, y_start, x_end - x_start, y_end - y_start };
+    for (int y = y_start; y < y_end; y++) {
+        state->dirty_lines[y] = true;
+    }
+    memset(state->dirty_columns, 0, epd_width() / 2);
+    for (int x = x_start; x < x_end; x++) {
+        state->dirty_columns[x / 2] |= x % 2 ? 0xF0 : 0x0F;
+    }
+    update_ghosting_counters(
+        state, ink->mode, inked, state->dirty_lines, state->dirty_columns, false
+    );
+
+    return err;
+}
+
+void epd_hl_ink_end(EpdInkState* ink) {
+    assert(ink != NULL);
+    epd_poweroff();
+    heap_caps_free(ink->layer);
+    ink->layer = NULL;
+    ink->queue_head = ink->queue_tail = 0;
+}
@@ -19,14 +19,21 @@ LineQueue_t lq_init(int queue_len, int element_size) {
     queue.size = queue_len;
     queue.current = 0;
     queue.last = 0;
+    queue.reserved = 0;
 
     int elem_buf_size = ceil_div(element_size, 16) * 16;
 
     queue.bufs = calloc(queue.size, elem_buf_size);
     assert(queue.bufs != NULL);
 
+#ifdef RENDER_METHOD_LCD
+    // elements may be read by DMA in place
+    uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+#else
+    uint32_t caps = MALLOC_CAP_INTERNAL;
+#endif
     for (int i = 0; i < queue.size; i++) {
-        queue.bufs[i] = heap_caps_aligned_alloc(16, elem_buf_size, MALLOC_CAP_INTERNAL);
+        queue.bufs[i] = heap_caps_aligned_alloc(16, elem_buf_size, caps);
         assert(queue.bufs[i] != NULL);
     }
 
@@ -80,7 +87,35 @@ int IRAM_ATTR lq_read(LineQueue_t* queue, uint8_t* dst) {
     return 0;
 }
 
+uint8_t* IRAM_ATTR lq_reserve(LineQueue_t* queue) {
+    int current = atomic_load_explicit(&queue->current, memory_order_acquire);
+    int reserved = atomic_load_explicit(&queue->reserved, memory_order_acquire);
+
+    if (current == reserved) {
+        return NULL;
+    }
+
+    uint8_t* buf = queue->bufs[reserved];
+    queue->reserved = (reserved + 1) % queue->size;
+    return buf;
+}
+
+void IRAM_ATTR lq_release(LineQueue_t* queue) {
+    int last = atomic_load_explicit(&queue->last, memory_order_acquire);
+    // nothing reserved, e.g. after a reset
+    if (last == queue->reserved) {
+        return;
+    }
+
+    if (last == queue->size - 1) {
+        queue->last = 0;
+    } else {
+        atomic_fetch_add(&queue->last, 1);
+    }
+}
+
 void IRAM_ATTR lq_reset(LineQueue_t* queue) {
     queue->current = 0;
     queue->last = 0;
+    queue->reserved = 0;
 }
@@ -11,6 +11,8 @@ typedef struct {
     int size;
     atomic_int current;
     atomic_int last;
+    /// Next element to reserve with `lq_reserve()`.
+    atomic_int reserved;
     uint8_t** bufs;
     // size of an element
     size_t element_size;
@@ -35,6 +37,15 @@ void lq_commit(LineQueue_t* queue);
 /// Returns 0 for a successful read to `dst`, -1 for a failed read (empty queue).
 int lq_read(LineQueue_t* queue, uint8_t* dst);
 
+/// Reserve the next element for reading it in place, without freeing it.
+/// Must not be mixed with `lq_read()` on the same queue.
+///
+/// Returns NULL if there is no element to reserve.
+uint8_t* lq_reserve(LineQueue_t* queue);
+
+/// Free the oldest reserved element for writing.
+void lq_release(LineQueue_t* queue);
+
 /// Reset the queue into an empty state.
 /// This operation is *not* atomic!
 void lq_reset(LineQueue_t* queue);
@@ -441,15 +441,18 @@ LutFunctionPair find_lut_functions(enum EpdDrawMode mode, uint32_t lut_size) {
     LutFunctionPair pair;
     pair.build_func = NULL;
     pair.lookup_func = NULL;
+    pair.build_size = 0;
 
     if (mode & MODE_PACKING_1PPB_DIFFERENCE) {
         if (EPD_CURRENT_RENDER_METHOD == RENDER_METHOD_LCD && !(mode & MODE_FORCE_NO_PIE)
             && lut_size >= 1024) {
             pair.build_func = &build_1ppB_lut_S3_VE_1k;
+            pair.build_size = 1 << 10;
             pair.lookup_func = &calc_epd_input_1ppB_1k_S3_VE;
             return pair;
         } else if (lut_size >= 1 << 16) {
             pair.build_func = &build_1ppB_lut_64k;
+            pair.build_size = 1 << 16;
             pair.lookup_func = &calc_epd_input_1ppB_64k;
             return pair;
         }
@@ -457,20 +460,24 @@ LutFunctionPair find_lut_functions(enum EpdDrawMode mode, uint32_t lut_size) {
         if (lut_size >= 1 << 16) {
             if (mode & PREVIOUSLY_WHITE) {
                 pair.build_func = &build_2ppB_lut_64k_from_15;
+                pair.build_size = 1 << 16;
                 pair.lookup_func = &calc_epd_input_2ppB_lut_64k;
                 return pair;
             } else if (mode & PREVIOUSLY_BLACK) {
                 pair.build_func = &build_2ppB_lut_64k_from_0;
+                pair.build_size = 1 << 16;
                 pair.lookup_func = &calc_epd_input_2ppB_lut_64k;
                 return pair;
             }
         } else if (lut_size >= 1024) {
             if (mode & PREVIOUSLY_WHITE) {
                 pair.build_func = &build_2ppB_lut_1k;
+                pair.build_size = 1 << 10;
                 pair.lookup_func = &calc_epd_input_2ppB_1k_lut_white;
                 return pair;
             } else if (mode & PREVIOUSLY_BLACK) {
                 pair.build_func = &build_2ppB_lut_1k;
+                pair.build_size = 1 << 10;
                 pair.lookup_func = &calc_epd_input_2ppB_1k_lut_black;
                 return pair;
             }
@@ -482,10 +489,12 @@ LutFunctionPair find_lut_functions(enum EpdDrawMode mode, uint32_t lut_size) {
 
         if (mode & PREVIOUSLY_WHITE) {
             pair.build_func = &build_8ppB_lut_256b_from_white;
+            pair.build_size = sizeof(lut_8ppB_start_at_white);
             pair.lookup_func = &calc_epd_input_8ppB;
             return pair;
         } else if (mode & PREVIOUSLY_BLACK) {
             pair.build_func = &build_8ppB_lut_256b_from_black;
+            pair.build_size = sizeof(lut_8ppB_start_at_black);
             pair.lookup_func = &calc_epd_input_8ppB;
             return pair;
         }
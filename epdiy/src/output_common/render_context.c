@@ -1,6 +1,7 @@
 #include "render_context.h"
 
 #include <string.h>
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 
 #include "../epdiy.h"
@@ -15,6 +16,173 @@ static inline int min(int x, int y) {
     return x < y ? x : y;
 }
 
+/// Number of (waveform phases, LUT layout) combinations to keep lookup tables for.
+#define LUT_CACHE_ENTRIES 4
+/// Larger tables are rebuilt for every frame, copying them would not be faster.
+#define LUT_CACHE_MAX_BUILD_SIZE (1 << 10)
+/// Maximum number of frames in a cached waveform, as counted by `epd_draw_base`.
+#define LUT_CACHE_MAX_FRAMES 256
+
+/**
+ * Lookup tables for all frames of one waveform mode and temperature range,
+ * as built by one LUT build function.
+ * The tables are built on first use and kept in PSRAM.
+ */
+typedef struct {
+    const EpdWaveformPhases* phases;
+    lut_build_func_t build_func;
+    uint8_t* tables;
+    /// Bitmap of frames for which `tables` is populated.
+    uint32_t built[LUT_CACHE_MAX_FRAMES / 32];
+    /// Value of `lut_cache_clock` at the last use, for replacement.
+    uint32_t last_used;
+} LutCacheEntry;
+
+static LutCacheEntry lut_cache[LUT_CACHE_ENTRIES];
+static uint32_t lut_cache_clock = 0;
+
+static LutCacheEntry* lut_cache_entry(
+    const EpdWaveformPhases* phases, lut_build_func_t build_func, size_t build_size
+) {
+    LutCacheEntry* victim = &lut_cache[0];
+    for (int i = 0; i < LUT_CACHE_ENTRIES; i++) {
+        LutCacheEntry* entry = &lut_cache[i];
+        if (entry->phases == phases && entry->build_func == build_func) {
+            return entry;
+        }
+        if (entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+
+    heap_caps_free(victim->tables);
+    memset(victim, 0, sizeof(LutCacheEntry));
+
+    victim->tables = heap_caps_malloc(phases->phases * build_size, MALLOC_CAP_SPIRAM);
+    if (victim->tables == NULL) {
+        return NULL;
+    }
+    victim->phases = phases;
+    victim->build_func = build_func;
+    return victim;
+}
+
+void IRAM_ATTR build_waveform_lut(
+    uint8_t* lut,
+    const EpdWaveformPhases* phases,
+    lut_build_func_t build_func,
+    size_t size,
+    int frame
+) {
+    if (phases == NULL || size == 0 || size > LUT_CACHE_MAX_BUILD_SIZE
+        || phases->phases > LUT_CACHE_MAX_FRAMES) {
+        build_func(lut, phases, frame);
+        return;
+    }
+
+    LutCacheEntry* entry = lut_cache_entry(phases, build_func, size);
+    if (entry == NULL) {
+        build_func(lut, phases, frame);
+        return;
+    }
+    entry->last_used = ++lut_cache_clock;
+
+    uint8_t* table = entry->tables + frame * size;
+    uint32_t frame_bit = 1 << (frame % 32);
+    if (entry->built[frame / 32] & frame_bit) {
+        memcpy(lut, table, size);
+    } else {
+        build_func(lut, phases, frame);
+        memcpy(table, lut, size);
+        entry->built[frame / 32] |= frame_bit;
+    }
+}
+
+void start_feed_tasks(RenderContext_t* ctx) {
+    // A thread on this core preempts the caller when woken,
+    // so threads on other cores are woken first.
+    int core = xPortGetCoreID();
+    for (int i = 0; i < ctx->num_threads; i++) {
+        if (ctx->feed_task_cores[i] != core) {
+            xTaskNotifyGive(ctx->feed_tasks[i]);
+        }
+    }
+    for (int i = 0; i < ctx->num_threads; i++) {
+        if (ctx->feed_task_cores[i] == core) {
+            xTaskNotifyGive(ctx->feed_tasks[i]);
+        }
+    }
+}
+
+void mark_skipped_frames(RenderContext_t* ctx, const EpdTransitionHistogram* transitions) {
+    memset(ctx->skipped_frames, 0, sizeof(ctx->skipped_frames));
+    if (transitions == NULL || (ctx->mode & MODE_EPDIY_MONOCHROME)
+        || !(ctx->mode & MODE_PACKING_1PPB_DIFFERENCE)) {
+        return;
+    }
+
+    const EpdWaveformPhases* phases
+        = ctx->waveform->mode_data[ctx->waveform_index]->range_data[ctx->waveform_range];
+
+    int skipped = 0;
+    for (int frame = 0; frame < min(ctx->cycle_frames, 256); frame++) {
+        const uint8_t* p_lut = phases->luts + (16 * 4 * frame);
+        bool active = false;
+        for (int t = 0; t < 256 && !active; t++) {
+            if (transitions->counts[t] == 0) {
+                continue;
+            }
+            int to = t >> 4;
+            int from = t & 0xF;
+            uint8_t packed = p_lut[(to << 2) | (from >> 2)];
+            active = ((packed >> (6 - 2 * (from & 3))) & 3) != 0;
+        }
+        if (!active) {
+            ctx->skipped_frames[frame / 32] |= 1 << (frame % 32);
+            skipped++;
+        }
+    }
+    ESP_LOGD("epdiy", "skipping %d of %d frames", skipped, ctx->cycle_frames);
+}
+
+bool IRAM_ATTR frame_is_skipped(const RenderContext_t* ctx) {
+    int frame = ctx->current_frame;
+    return frame < 256 && (ctx->skipped_frames[frame / 32] & (1 << (frame % 32))) != 0;
+}
+
+bool IRAM_ATTR frame_is_final(const RenderContext_t* ctx) {
+    for (int frame = ctx->current_frame + 1; frame < ctx->cycle_frames; frame++) {
+        if (frame >= 256 || (ctx->skipped_frames[frame / 32] & (1 << (frame % 32))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void copy_back_difference(RenderContext_t* ctx) {
+    if (ctx->copy_back_ptr == NULL) {
+        return;
+    }
+    if (ctx->mode & MODE_PACKING_4PPB) {
+        epd_difference_copy_back_packed(
+            ctx->data_ptr, ctx->copy_back_ptr, ctx->copy_back, EPD_FB_2BPP, ctx->drawn_lines
+        );
+    } else {
+        epd_difference_copy_back(
+            ctx->data_ptr, ctx->copy_back_ptr, ctx->copy_back, ctx->drawn_lines, ctx->drawn_columns
+        );
+    }
+    ctx->copy_back_ptr = NULL;
+}
+
+void epd_lut_cache_clear() {
+    for (int i = 0; i < LUT_CACHE_ENTRIES; i++) {
+        heap_caps_free(lut_cache[i].tables);
+    }
+    memset(lut_cache, 0, sizeof(lut_cache));
+    lut_cache_clock = 0;
+}
+
 void get_buffer_params(
     RenderContext_t* ctx,
     int* bytes_per_line,
@@ -83,10 +251,12 @@ void IRAM_ATTR prepare_context_for_next_frame(RenderContext_t* ctx) {
         = ctx->waveform->mode_data[ctx->waveform_index]->range_data[ctx->waveform_range];
 
     assert(ctx->lut_build_func != NULL);
-    ctx->lut_build_func(ctx->conversion_lut, phases, ctx->current_frame);
+    build_waveform_lut(
+        ctx->conversion_lut, phases, ctx->lut_build_func, ctx->lut_build_size, ctx->current_frame
+    );
 
-    ctx->lines_prepared = 0;
-    ctx->lines_consumed = 0;
+    ctx->lines_prepared = ctx->lines_skipped;
+    ctx->lines_consumed = ctx->lines_skipped;
 }
 
 void epd_populate_line_mask(uint8_t* line_mask, const uint8_t* dirty_columns, int mask_len) {
@@ -10,13 +10,81 @@
 #include "line_queue.h"
 #include "lut.h"
 
+/// Maximum number of render threads.
 #define NUM_RENDER_THREADS 2
 
+/// A difference calculation split across the render threads in bands of lines.
+typedef struct {
+    const uint8_t* to;
+    const uint8_t* from;
+    EpdRect crop_to;
+    int fb_width;
+    /// Optional dirty tile map, see `epd_difference_image_tiles()`.
+    const uint8_t* dirty_tiles;
+    uint8_t* interlaced;
+    bool* dirty_lines;
+    /// Column dirtyness of each thread, merged after all threads are done.
+    uint8_t* col_dirtyness[NUM_RENDER_THREADS];
+    /// Line buffers for interlacing if `interlaced` is NULL.
+    uint8_t* scratch_lines[NUM_RENDER_THREADS];
+} DiffJob_t;
+
+/// Performance counters of a render thread during the current update.
+typedef struct {
+    /// Total time spent preparing frames in microseconds.
+    uint32_t feed_us;
+    /// Longest frame preparation in microseconds.
+    uint32_t max_feed_us;
+    /// Number of times a line had to wait for a free element of the full line queue.
+    uint32_t queue_stalls;
+} FeedStats_t;
+
+/// Life cycle of an update region, see `epd_region_start()`.
+enum UpdateRegionState {
+    REGION_FREE = 0,
+    /// Started, waiting for the next frame of the region update.
+    REGION_PENDING,
+    /// Drawn in each frame until its waveform is complete.
+    REGION_ACTIVE,
+    /// Complete, but not yet collected by `epd_region_wait()`.
+    REGION_DONE,
+};
+
+/**
+ * An update region with its own waveform, progressing through its frames
+ * independently of the other active regions.
+ */
+typedef struct {
+    enum UpdateRegionState state;
+    EpdRect area;
+    const EpdWaveformPhases* phases;
+    lut_build_func_t lut_build_func;
+    /// frame of the region waveform drawn next
+    int current_frame;
+    /// number of frames of the region waveform
+    int cycle_frames;
+    /// Lookup table of the current frame.
+    uint8_t* lut;
+    /// Output line mask selecting the columns of the region.
+    uint8_t* line_mask;
+    /// Given when the region is done.
+    SemaphoreHandle_t done;
+    enum EpdDrawError error;
+} UpdateRegion_t;
+
 typedef struct {
     EpdRect area;
     EpdRect crop_to;
     const bool* drawn_lines;
+    const uint8_t* drawn_columns;
     const uint8_t* data_ptr;
+    /// If not NULL, `data_ptr` is the 2ppB goal image and the difference
+    /// to this previous image is calculated line by line while drawing.
+    const uint8_t* diff_from_ptr;
+    /// If not NULL, `copy_back` of this buffer (`diff_from_ptr`) is updated to
+    /// `data_ptr` once the last frame has been prepared.
+    uint8_t* copy_back_ptr;
+    EpdRect copy_back;
 
     /// The display width for quick access.
     int display_width;
@@ -27,17 +95,33 @@ typedef struct {
     atomic_int lines_prepared;
     volatile int lines_consumed;
     int lines_total;
+    /// Lines at the top of each frame that contain no drawn lines.
+    /// They are skipped without clocking out line data.
+    /// A multiple of 8, only used by the LCD render method.
+    int lines_skipped;
 
     /// frame currently in the current update cycle
     int current_frame;
     /// number of frames in the current update cycle
     int cycle_frames;
+    /// Bitmap of frames in the current update cycle which do not drive any pixel.
+    uint32_t skipped_frames[8];
 
+    /// Number of render threads in use, at most `NUM_RENDER_THREADS`.
+    int num_threads;
     TaskHandle_t feed_tasks[NUM_RENDER_THREADS];
+    /// Core each render thread is pinned to, or `EPD_RENDER_ANY_CORE`.
+    int feed_task_cores[NUM_RENDER_THREADS];
     SemaphoreHandle_t feed_done_smphr[NUM_RENDER_THREADS];
     SemaphoreHandle_t frame_done;
     /// Line buffers for feed tasks
     uint8_t* feed_line_buffers[NUM_RENDER_THREADS];
+    /// Scratch column dirtyness for feed tasks calculating differences
+    uint8_t* feed_dirtyness_buffers[NUM_RENDER_THREADS];
+    /// If not NULL, the feed tasks calculate this difference instead of a frame.
+    const DiffJob_t* diff_job;
+    /// Performance counters of each feed task, reset for each update.
+    FeedStats_t feed_stats[NUM_RENDER_THREADS];
 
     /// index of the waveform mode when using vendor waveforms.
     /// This is not necessarily the mode number if the waveform header
@@ -63,6 +147,8 @@ typedef struct {
     lut_func_t lut_lookup_func;
     /// LUT building function. Must not be NULL
     lut_build_func_t lut_build_func;
+    /// Number of LUT bytes written by `lut_build_func`.
+    size_t lut_build_size;
 
     /// Queue of lines prepared for output to the display,
     /// one for each thread.
@@ -77,6 +163,14 @@ typedef struct {
 
     /// line buffer when using epd_push_pixels
     uint8_t* static_line_buffer;
+
+    /// Concurrent update regions, see `epd_region_start()`.
+    UpdateRegion_t regions[EPD_MAX_UPDATE_REGIONS];
+    /// Bitmap of the regions drawn in the current frame.
+    /// If not 0, each line is looked up with the LUTs of the regions it belongs to.
+    uint32_t regions_drawn;
+    /// Line buffers of the feed tasks for merging the lines of several regions.
+    uint8_t* region_line_buffers[NUM_RENDER_THREADS];
 } RenderContext_t;
 
 /**
@@ -99,6 +193,52 @@ void get_buffer_params(
  */
 void prepare_context_for_next_frame(RenderContext_t* ctx);
 
+/**
+ * Build the lookup table of a waveform frame into `lut`.
+ * Small tables are cached per waveform phases and build function,
+ * so repeated updates with the same mode and temperature only copy them.
+ */
+void build_waveform_lut(
+    uint8_t* lut,
+    const EpdWaveformPhases* phases,
+    lut_build_func_t build_func,
+    size_t size,
+    int frame
+);
+
+/**
+ * Wake the render threads to draw the next frame.
+ */
+void start_feed_tasks(RenderContext_t* ctx);
+
+/**
+ * Mark the frames of the current waveform that do not drive any of the
+ * transitions present in `transitions` as skipped.
+ */
+void mark_skipped_frames(RenderContext_t* ctx, const EpdTransitionHistogram* transitions);
+
+/**
+ * Check if the current frame of the update cycle is skipped.
+ */
+bool frame_is_skipped(const RenderContext_t* ctx);
+
+/**
+ * Check if the current frame is the last one drawn in the update cycle,
+ * i.e. all following frames are skipped.
+ */
+bool frame_is_final(const RenderContext_t* ctx);
+
+/**
+ * Update the previous image of a difference update if requested,
+ * once the render threads are done reading it.
+ */
+void copy_back_difference(RenderContext_t* ctx);
+
+/**
+ * Free all lookup tables cached for previous updates.
+ */
+void epd_lut_cache_clear();
+
 /**
  * Populate an output line mask from line dirtyness with two bits per pixel.
  * If the dirtyness data is NULL, set the mask to neutral.
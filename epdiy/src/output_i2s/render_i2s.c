@@ -158,16 +158,21 @@ static void i2s_end_frame() {
 
 void i2s_do_update(RenderContext_t* ctx) {
     for (uint8_t k = 0; k < ctx->cycle_frames; k++) {
+        // frames that do not drive any pixel present
+        if (frame_is_skipped(ctx)) {
+            ctx->current_frame++;
+            continue;
+        }
+
         prepare_context_for_next_frame(ctx);
 
         // start both feeder tasks
-        xTaskNotifyGive(ctx->feed_tasks[!xPortGetCoreID()]);
-        xTaskNotifyGive(ctx->feed_tasks[xPortGetCoreID()]);
+        start_feed_tasks(ctx);
 
         // transmission is started in renderer threads, now wait util it's done
         xSemaphoreTake(ctx->frame_done, portMAX_DELAY);
 
-        for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+        for (int i = 0; i < ctx->num_threads; i++) {
             xSemaphoreTake(ctx->feed_done_smphr[i], portMAX_DELAY);
         }
 
@@ -308,7 +313,10 @@ void IRAM_ATTR i2s_fetch_frame_data(RenderContext_t* ctx, int thread_id) {
 
         if (l < min_y || l >= max_y
             || (ctx->drawn_lines != NULL && !ctx->drawn_lines[l - area.y])) {
-            uint8_t* buf = NULL;
+            uint8_t* buf = lq_current(lq);
+            if (buf == NULL) {
+                ctx->feed_stats[thread_id].queue_stalls++;
+            }
             while (buf == NULL)
                 buf = lq_current(lq);
             memset(buf, 0x00, lq->element_size);
@@ -380,7 +388,10 @@ void IRAM_ATTR i2s_fetch_frame_data(RenderContext_t* ctx, int thread_id) {
             lp = (uint32_t*)input_line;
         }
 
-        uint8_t* buf = NULL;
+        uint8_t* buf = lq_current(lq);
+        if (buf == NULL) {
+            ctx->feed_stats[thread_id].queue_stalls++;
+        }
         while (buf == NULL)
             buf = lq_current(lq);
 
@@ -68,8 +68,17 @@ static inline int max(int x, int y) {
 #define S3_LCD_PIN_NUM_BK_LIGHT -1
 // #define S3_LCD_PIN_NUM_MODE           4
 
-#define LINE_BATCH 1000
-#define BOUNCE_BUF_LINES 4
+// The vertical line count of the LCD peripheral and the RMT loop count are limited to 10 bits.
+#define MAX_LINE_BATCH 1000
+#define DEFAULT_LINE_BATCH 1000
+// Bounce buffer depths divide the frame lines, which are a multiple of 8.
+#define MAX_BOUNCE_BUF_LINES 8
+#define DEFAULT_BOUNCE_BUF_LINES 4
+
+/// Minimum output time of a bounce buffer with automatic depth, bounding the refill rate.
+#define AUTO_MIN_BOUNCE_US 40
+/// Refill interrupt latency to allow for with automatic depth.
+#define AUTO_REFILL_LATENCY_US 10
 
 #define RMT_CKV_CHAN RMT_CHANNEL_1
 
@@ -94,6 +103,10 @@ typedef struct {
     void* line_cb_payload;
     void* frame_cb_payload;
 
+    line_slot_func_t line_slot_cb;
+    line_release_func_t line_release_cb;
+    void* line_slot_payload;
+
     int line_length_us;
     int line_cycles;
     int lcd_res_h;
@@ -103,8 +116,26 @@ typedef struct {
     uint8_t* bounce_buffer[2];
     // size of a single bounce buffer
     size_t bb_size;
+    // lines per bounce buffer
+    int bb_lines;
+    // lines per bounce buffer the buffers are allocated for
+    int bb_max_lines;
+    // bounce buffer depth to use from the next frame
+    int bb_next_lines;
+    // whether the bounce buffer depth is chosen by the driver
+    bool bb_auto;
+    // lines per run of the LCD peripheral
+    int line_batch;
     size_t batches;
 
+    /// Time to copy a line in nanoseconds, measured at init.
+    int line_copy_ns;
+    /// Entry time of the previous refill interrupt of this run, 0 if there is none.
+    int64_t last_refill_us;
+    /// Underruns in the current frame.
+    int frame_underruns;
+    LcdEpdStats_t stats;
+
     // Number of DMA descriptors that used to carry the frame buffer
     size_t num_dma_nodes;
     // DMA channel handle
@@ -112,6 +143,18 @@ typedef struct {
     // DMA descriptors pool
     dma_descriptor_t* dma_nodes;
 
+    /// Whether the current frame is output from line slots in place.
+    bool zero_copy;
+    /// Descriptors for zero-copy output, a dummy and a data node for each line.
+    /// Like the bounce buffers, the list is split into two halves.
+    dma_descriptor_t* slot_nodes;
+    /// Lines in use by the data nodes, to be released once output.
+    const uint8_t* held_slots[2 * MAX_BOUNCE_BUF_LINES];
+    /// Empty line for data nodes without a line slot.
+    uint8_t* empty_line;
+    /// Dummy bytes for the dummy nodes.
+    uint8_t* dummy_buffer;
+
     /// The number of bytes in a horizontal display register line.
     int line_bytes;
 
@@ -123,6 +166,12 @@ typedef struct {
 
     /// The number of lines of the display
     int display_lines;
+
+    /// The number of lines clocked out per frame, at most `display_lines`.
+    int frame_lines;
+
+    /// The number of lines at the top of the frame skipped with fast CKV pulses.
+    int skipped_lines;
 } s3_lcd_t;
 
 static s3_lcd_t lcd = { 0 };
@@ -132,6 +181,13 @@ void IRAM_ATTR epd_lcd_line_source_cb(line_cb_func_t line_source, void* payload)
     lcd.line_cb_payload = payload;
 }
 
+void IRAM_ATTR
+epd_lcd_line_slot_cb(line_slot_func_t slot, line_release_func_t release, void* payload) {
+    lcd.line_slot_cb = slot;
+    lcd.line_release_cb = release;
+    lcd.line_slot_payload = payload;
+}
+
 void IRAM_ATTR epd_lcd_frame_done_cb(frame_done_func_t cb, void* payload) {
     lcd.frame_done_cb = cb;
     lcd.frame_cb_payload = payload;
@@ -140,7 +196,7 @@ void IRAM_ATTR epd_lcd_frame_done_cb(frame_done_func_t cb, void* payload) {
 static IRAM_ATTR bool fill_bounce_buffer(uint8_t* buffer) {
     bool task_awoken = false;
 
-    for (int i = 0; i < BOUNCE_BUF_LINES; i++) {
+    for (int i = 0; i < lcd.bb_lines; i++) {
         if (lcd.line_source_cb != NULL) {
             // this is strange, with 16 bit need a dummy cycle. But still, the first byte in the
             // FIFO is correct. So we only need a true dummy byte in the FIFO in the 8 bit
@@ -154,6 +210,49 @@ static IRAM_ATTR bool fill_bounce_buffer(uint8_t* buffer) {
     return task_awoken;
 }
 
+/// Number of zero-copy DMA descriptors per bounce buffer sized half of the list.
+static inline int slot_nodes_per_half() {
+    return 2 * lcd.bb_lines;
+}
+
+/// Index of the data node of a line in the zero-copy descriptor list.
+/// The dummy byte(s) come before the data with an 8 bit bus, after it with a 16 bit bus.
+static inline int slot_data_node(int line) {
+    return 2 * line + (lcd.dummy_bytes % 2);
+}
+
+/**
+ * Release the lines of one half of the zero-copy list, which are output,
+ * and point its data nodes to the next lines.
+ */
+static IRAM_ATTR void fill_line_slots(int half) {
+    for (int i = half * lcd.bb_lines; i < (half + 1) * lcd.bb_lines; i++) {
+        if (lcd.held_slots[i] != NULL) {
+            lcd.line_release_cb(lcd.line_slot_payload, lcd.held_slots[i]);
+            lcd.held_slots[i] = NULL;
+        }
+        const uint8_t* slot = NULL;
+        if (lcd.line_slot_cb != NULL) {
+            slot = lcd.line_slot_cb(lcd.line_slot_payload);
+        }
+        lcd.slot_nodes[slot_data_node(i)].buffer = slot ? (void*)slot : lcd.empty_line;
+        lcd.held_slots[i] = slot;
+    }
+}
+
+/// Release all lines still held by the zero-copy list, after the output stopped.
+static IRAM_ATTR void release_line_slots() {
+    if (lcd.line_release_cb == NULL) {
+        return;
+    }
+    for (int i = 0; i < 2 * MAX_BOUNCE_BUF_LINES; i++) {
+        if (lcd.held_slots[i] != NULL) {
+            lcd.line_release_cb(lcd.line_slot_payload, lcd.held_slots[i]);
+            lcd.held_slots[i] = NULL;
+        }
+    }
+}
+
 static void start_ckv_cycles(int cycles) {
     rmt_ll_tx_enable_loop_count(&RMT, RMT_CKV_CHAN, true);
     rmt_ll_tx_enable_loop_autostop(&RMT, RMT_CKV_CHAN, true);
@@ -175,6 +274,46 @@ static void ckv_rmt_build_signal() {
     rmt_mem_ptr[1].val = 0;
 }
 
+/// CKV high and low time in 1/10us for skipping lines.
+/// According to the spec, the OC4 maximum CKV frequency is 200kHz.
+#define SKIP_CKV_HIGH_TIME 45
+#define SKIP_CKV_LOW_TIME 5
+
+/**
+ * Build a short RMT signal for shifting through lines without data.
+ */
+static void ckv_rmt_build_skip_signal() {
+    volatile rmt_item32_t* rmt_mem_ptr = &(RMTMEM.chan[RMT_CKV_CHAN].data32[0]);
+    rmt_mem_ptr->duration0 = SKIP_CKV_HIGH_TIME;
+    rmt_mem_ptr->level0 = 1;
+    rmt_mem_ptr->duration1 = SKIP_CKV_LOW_TIME;
+    rmt_mem_ptr->level1 = 0;
+    rmt_mem_ptr[1].val = 0;
+}
+
+/**
+ * Start the vertical shift register and move it through the skipped lines,
+ * without clocking out line data.
+ * Afterwards, the next CKV cycle selects the first line after the skipped ones,
+ * like the first cycle of a frame without skipped lines selects the first line.
+ */
+static void skip_frame_lines() {
+    const int skip_cycle_us = (SKIP_CKV_HIGH_TIME + SKIP_CKV_LOW_TIME) / 10;
+
+    ckv_rmt_build_skip_signal();
+    gpio_set_level(lcd.config.bus.stv, 0);
+    start_ckv_cycles(1);
+    esp_rom_delay_us(skip_cycle_us);
+    gpio_set_level(lcd.config.bus.stv, 1);
+
+    for (int remaining = lcd.skipped_lines - 1; remaining > 0; remaining -= lcd.line_batch) {
+        int cycles = min(remaining, lcd.line_batch);
+        start_ckv_cycles(cycles);
+        esp_rom_delay_us(cycles * skip_cycle_us);
+    }
+    ckv_rmt_build_signal();
+}
+
 /**
  * Configure the RMT peripheral for use as the CKV clock.
  */
@@ -221,23 +360,32 @@ __attribute__((optimize("O3"))) IRAM_ATTR static void lcd_isr_vsync(void* args)
     lcd_ll_clear_interrupt_status(lcd.hal.dev, intr_status);
 
     if (intr_status & LCD_LL_EVENT_VSYNC_END) {
-        int batches_needed = lcd.display_lines / LINE_BATCH;
-        if (lcd.batches >= batches_needed) {
+        int data_lines = lcd.frame_lines - lcd.skipped_lines;
+        int batches_needed = (data_lines + lcd.line_batch - 1) / lcd.line_batch;
+        // `lcd.batches` counts the batches after the first one, started with the frame
+        if (lcd.batches >= batches_needed - 1) {
             lcd_ll_stop(lcd.hal.dev);
+            lcd.stats.frames += 1;
+            if (lcd.zero_copy) {
+                release_line_slots();
+            }
             if (lcd.frame_done_cb != NULL) {
                 (*lcd.frame_done_cb)(lcd.frame_cb_payload);
             }
         } else {
             int ckv_cycles = 0;
-            // last batch
-            if (lcd.batches == batches_needed - 1) {
+            // last batch, with the remaining lines, never empty
+            if (lcd.batches == batches_needed - 2) {
+                int last_lines = data_lines - (batches_needed - 1) * lcd.line_batch;
                 lcd_ll_enable_auto_next_frame(lcd.hal.dev, false);
-                lcd_ll_set_vertical_timing(lcd.hal.dev, 1, 0, lcd.display_lines % LINE_BATCH, 10);
-                ckv_cycles = lcd.display_lines % LINE_BATCH + 10;
+                lcd_ll_set_vertical_timing(lcd.hal.dev, 1, 0, last_lines, 10);
+                ckv_cycles = last_lines + 10;
             } else {
-                lcd_ll_set_vertical_timing(lcd.hal.dev, 1, 0, LINE_BATCH, 1);
-                ckv_cycles = LINE_BATCH + 1;
+                lcd_ll_set_vertical_timing(lcd.hal.dev, 1, 0, lcd.line_batch, 1);
+                ckv_cycles = lcd.line_batch + 1;
             }
+            // the output pauses between runs, so refill timing starts over
+            lcd.last_refill_us = 0;
             // apparently, this is needed for the new timing to take effect.
             lcd_ll_start(lcd.hal.dev);
 
@@ -259,22 +407,115 @@ static IRAM_ATTR bool lcd_rgb_panel_eof_handler(
     gdma_channel_handle_t dma_chan, gdma_event_data_t* event_data, void* user_data
 ) {
     dma_descriptor_t* desc = (dma_descriptor_t*)event_data->tx_eof_desc_addr;
-    // Figure out which bounce buffer to write to.
-    // Note: what we receive is the *last* descriptor of this bounce buffer.
-    int bb = (desc == &lcd.dma_nodes[0]) ? 0 : 1;
-    return fill_bounce_buffer(lcd.bounce_buffer[bb]);
+    int64_t start_us = esp_timer_get_time();
+    bool task_awoken = false;
+    if (lcd.zero_copy) {
+        fill_line_slots(desc == &lcd.slot_nodes[slot_nodes_per_half() - 1] ? 0 : 1);
+    } else {
+        // Figure out which bounce buffer to write to.
+        // Note: what we receive is the *last* descriptor of this bounce buffer.
+        int bb = (desc == &lcd.dma_nodes[0]) ? 0 : 1;
+        task_awoken = fill_bounce_buffer(lcd.bounce_buffer[bb]);
+    }
+    int64_t end_us = esp_timer_get_time();
+
+    // The DMA reaches the refilled buffer again one buffer output time after
+    // the end of file event, which happened before this interrupt and
+    // one buffer output time after the previous one.
+    int64_t buffer_us = lcd.bb_lines * lcd.line_length_us;
+    int64_t deadline = start_us + buffer_us;
+    if (lcd.last_refill_us > 0 && lcd.last_refill_us + 2 * buffer_us < deadline) {
+        deadline = lcd.last_refill_us + 2 * buffer_us;
+    }
+    if (end_us > deadline) {
+        lcd.stats.underruns += 1;
+        lcd.frame_underruns += 1;
+    }
+    lcd.stats.refills += 1;
+    lcd.stats.total_refill_us += end_us - start_us;
+    if (end_us - start_us > lcd.stats.max_refill_us) {
+        lcd.stats.max_refill_us = end_us - start_us;
+    }
+    lcd.last_refill_us = start_us;
+    return task_awoken;
+}
+
+/**
+ * Set up the DMA descriptors for the current bounce buffer depth.
+ * Must only be called while the DMA is stopped.
+ */
+static IRAM_ATTR void link_dma_nodes() {
+    for (int i = 0; i < 2; i++) {
+        lcd.dma_nodes[i].dw0.size = lcd.bb_size;
+        lcd.dma_nodes[i].dw0.length = lcd.bb_size;
+    }
+
+    // The zero-copy list has the same layout as the bounce buffers,
+    // but separate nodes for the dummy bytes and the line data of each line.
+    if (lcd.slot_nodes != NULL) {
+        int num_nodes = 2 * slot_nodes_per_half();
+        for (int i = 0; i < num_nodes; i++) {
+            dma_descriptor_t* node = &lcd.slot_nodes[i];
+            bool data_node = (i == slot_data_node(i / 2));
+            node->dw0.size = data_node ? lcd.line_bytes : lcd.dummy_bytes;
+            node->dw0.length = node->dw0.size;
+            node->dw0.owner = DMA_DESCRIPTOR_BUFFER_OWNER_CPU;
+            // the end of each half triggers its refill
+            node->dw0.suc_eof = (i % slot_nodes_per_half() == slot_nodes_per_half() - 1);
+            node->buffer = data_node ? lcd.empty_line : lcd.dummy_buffer;
+            node->next = &lcd.slot_nodes[(i + 1) % num_nodes];
+        }
+    }
+}
+
+/// Switch to the bounce buffer depth chosen for the next frame, while the DMA is stopped.
+static IRAM_ATTR void apply_bounce_buffer_lines() {
+    if (lcd.bb_next_lines == lcd.bb_lines) {
+        return;
+    }
+    lcd.bb_lines = lcd.bb_next_lines;
+    lcd.bb_size = lcd.bb_lines * (lcd.line_bytes + lcd.dummy_bytes);
+    lcd.stats.bounce_buffer_lines = lcd.bb_lines;
+    link_dma_nodes();
+}
+
+/**
+ * Choose the smallest bounce buffer depth for which the refill interrupt
+ * keeps up with the output at the current line timing.
+ */
+static void choose_bounce_buffer_lines() {
+    int lines = 1;
+    for (; lines < lcd.bb_max_lines; lines *= 2) {
+        int buffer_ns = lines * lcd.line_length_us * 1000;
+        int refill_ns = AUTO_REFILL_LATENCY_US * 1000 + lines * lcd.line_copy_ns;
+        if (buffer_ns >= AUTO_MIN_BOUNCE_US * 1000 && refill_ns < buffer_ns) {
+            break;
+        }
+    }
+    lcd.bb_next_lines = lines;
+    ESP_LOGI(TAG, "using %d lines per bounce buffer", lines);
+}
+
+/**
+ * Measure the time the line source takes to copy a line,
+ * approximated by copying between the bounce buffers.
+ */
+static void measure_line_copy() {
+    const int rounds = 64;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) {
+        memcpy(lcd.bounce_buffer[i % 2], lcd.bounce_buffer[(i + 1) % 2], lcd.line_bytes);
+    }
+    int64_t end = esp_timer_get_time();
+    lcd.line_copy_ns = (end - start) * 1000 / rounds;
 }
 
 static esp_err_t init_dma_trans_link() {
     lcd.dma_nodes[0].dw0.suc_eof = 1;
-    lcd.dma_nodes[0].dw0.size = lcd.bb_size;
-    lcd.dma_nodes[0].dw0.length = lcd.bb_size;
     lcd.dma_nodes[0].dw0.owner = DMA_DESCRIPTOR_BUFFER_OWNER_CPU;
     lcd.dma_nodes[0].buffer = lcd.bounce_buffer[0];
 
     lcd.dma_nodes[1].dw0.suc_eof = 1;
-    lcd.dma_nodes[1].dw0.size = lcd.bb_size;
-    lcd.dma_nodes[1].dw0.length = lcd.bb_size;
     lcd.dma_nodes[1].dw0.owner = DMA_DESCRIPTOR_BUFFER_OWNER_CPU;
     lcd.dma_nodes[1].buffer = lcd.bounce_buffer[1];
 
@@ -282,6 +523,8 @@ static esp_err_t init_dma_trans_link() {
     lcd.dma_nodes[0].next = &lcd.dma_nodes[1];
     lcd.dma_nodes[1].next = &lcd.dma_nodes[0];
 
+    link_dma_nodes();
+
     // alloc DMA channel and connect to LCD peripheral
     gdma_channel_alloc_config_t dma_chan_config = {
         .direction = GDMA_CHANNEL_DIRECTION_TX,
@@ -418,6 +661,7 @@ static void assign_lcd_parameters_from_config(
 
     // Make sure the bounce buffers divide the display height evenly.
     lcd.display_lines = (((display_height + 7) / 8) * 8);
+    lcd.frame_lines = lcd.display_lines;
 
     lcd.line_bytes = display_width / 4;
     lcd.lcd_res_h = lcd.line_bytes / (lcd.config.bus_width / 8);
@@ -428,8 +672,36 @@ static void assign_lcd_parameters_from_config(
     // https://blog.adafruit.com/2022/06/14/esp32uesday-hacking-the-esp32-s3-lcd-peripheral/
     lcd.dummy_bytes = lcd.config.bus_width / 8;
 
+    lcd.line_batch = lcd.config.line_batch > 0 ? lcd.config.line_batch : DEFAULT_LINE_BATCH;
+    if (lcd.line_batch > MAX_LINE_BATCH) {
+        ESP_LOGW(TAG, "line batch %d too large, using %d", lcd.line_batch, MAX_LINE_BATCH);
+        lcd.line_batch = MAX_LINE_BATCH;
+    }
+
+    int bb_lines = lcd.config.bounce_buffer_lines;
+    lcd.bb_auto = bb_lines == EPD_LCD_BOUNCE_LINES_AUTO;
+    if (bb_lines == 0 || (!lcd.bb_auto && (bb_lines < 0 || MAX_BOUNCE_BUF_LINES % bb_lines != 0))) {
+        if (bb_lines != 0) {
+            ESP_LOGW(TAG, "unsupported bounce buffer depth %d, using default", bb_lines);
+        }
+        bb_lines = DEFAULT_BOUNCE_BUF_LINES;
+    }
+    // So far, I haven't seen any displays with > 4096 pixels per line,
+    // so we only need one DMA node per bounce buffer.
+    // Automatic depth is bounded by that instead.
+    lcd.bb_max_lines = lcd.bb_auto ? MAX_BOUNCE_BUF_LINES : bb_lines;
+    while (lcd.bb_auto && lcd.bb_max_lines > 1
+           && lcd.bb_max_lines * (lcd.line_bytes + lcd.dummy_bytes)
+                  >= DMA_DESCRIPTOR_BUFFER_MAX_SIZE) {
+        lcd.bb_max_lines /= 2;
+    }
+
     // each bounce buffer holds a number of lines with data + dummy bytes each
-    lcd.bb_size = BOUNCE_BUF_LINES * (lcd.line_bytes + lcd.dummy_bytes);
+    lcd.bb_lines = lcd.bb_auto ? lcd.bb_max_lines : bb_lines;
+    lcd.bb_next_lines = lcd.bb_lines;
+    lcd.bb_size = lcd.bb_lines * (lcd.line_bytes + lcd.dummy_bytes);
+
+    epd_lcd_reset_stats();
 
     check_cache_configuration();
 
@@ -442,17 +714,26 @@ static void assign_lcd_parameters_from_config(
 static esp_err_t allocate_lcd_buffers() {
     uint32_t dma_flags = MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
 
-    // allocate bounce buffers
+    // allocate bounce buffers for the largest depth in use
+    size_t bb_max_size = lcd.bb_max_lines * (lcd.line_bytes + lcd.dummy_bytes);
     for (int i = 0; i < 2; i++) {
-        lcd.bounce_buffer[i] = heap_caps_aligned_calloc(4, 1, lcd.bb_size, dma_flags);
+        lcd.bounce_buffer[i] = heap_caps_aligned_calloc(4, 1, bb_max_size, dma_flags);
         ESP_RETURN_ON_FALSE(lcd.bounce_buffer[i], ESP_ERR_NO_MEM, TAG, "install interrupt failed");
     }
 
-    // So far, I haven't seen any displays with > 4096 pixels per line,
-    // so we only need one DMA node for now.
-    assert(lcd.bb_size < DMA_DESCRIPTOR_BUFFER_MAX_SIZE);
+    assert(bb_max_size < DMA_DESCRIPTOR_BUFFER_MAX_SIZE);
     lcd.dma_nodes = heap_caps_calloc(1, sizeof(dma_descriptor_t) * 2, dma_flags);
     ESP_RETURN_ON_FALSE(lcd.dma_nodes, ESP_ERR_NO_MEM, TAG, "no mem for dma nodes");
+
+    if (lcd.config.zero_copy) {
+        size_t num_slot_nodes = 4 * lcd.bb_max_lines;
+        lcd.slot_nodes = heap_caps_calloc(1, sizeof(dma_descriptor_t) * num_slot_nodes, dma_flags);
+        ESP_RETURN_ON_FALSE(lcd.slot_nodes, ESP_ERR_NO_MEM, TAG, "no mem for dma nodes");
+        lcd.empty_line = heap_caps_aligned_calloc(4, 1, lcd.line_bytes, dma_flags);
+        ESP_RETURN_ON_FALSE(lcd.empty_line, ESP_ERR_NO_MEM, TAG, "no mem for empty line");
+        lcd.dummy_buffer = heap_caps_aligned_calloc(4, 1, 4, dma_flags);
+        ESP_RETURN_ON_FALSE(lcd.dummy_buffer, ESP_ERR_NO_MEM, TAG, "no mem for dummy bytes");
+    }
     return ESP_OK;
 }
 
@@ -469,6 +750,13 @@ static void free_lcd_buffers() {
         heap_caps_free(lcd.dma_nodes);
         lcd.dma_nodes = NULL;
     }
+
+    heap_caps_free(lcd.slot_nodes);
+    lcd.slot_nodes = NULL;
+    heap_caps_free(lcd.empty_line);
+    lcd.empty_line = NULL;
+    heap_caps_free(lcd.dummy_buffer);
+    lcd.dummy_buffer = NULL;
 }
 
 /**
@@ -569,6 +857,7 @@ void epd_lcd_init(const LcdEpdConfig_t* config, int display_width, int display_h
 
     ret = allocate_lcd_buffers();
     ESP_GOTO_ON_ERROR(ret, err, TAG, "lcd buffer allocation failed");
+    measure_line_copy();
 
     ret = init_lcd_peripheral();
     ESP_GOTO_ON_ERROR(ret, err, TAG, "lcd peripheral init failed");
@@ -597,6 +886,7 @@ err:
  */
 void epd_lcd_deinit() {
     epd_lcd_line_source_cb(NULL, NULL);
+    epd_lcd_line_slot_cb(NULL, NULL, NULL);
 
     deinit_bus_gpio();
     deinit_lcd_peripheral();
@@ -642,10 +932,43 @@ void epd_lcd_set_pixel_clock_MHz(int frequency) {
     ESP_LOGI(TAG, "line width: %dus, %d cylces", lcd.line_length_us, lcd.line_cycles);
 
     ckv_rmt_build_signal();
+
+    if (lcd.bb_auto) {
+        choose_bounce_buffer_lines();
+    }
+}
+
+void epd_lcd_get_stats(LcdEpdStats_t* stats) {
+    *stats = lcd.stats;
+}
+
+void epd_lcd_reset_stats() {
+    memset(&lcd.stats, 0, sizeof(LcdEpdStats_t));
+    lcd.stats.bounce_buffer_lines = lcd.bb_lines;
+    lcd.stats.line_batch = lcd.line_batch;
+}
+
+void epd_lcd_set_frame_lines(int lines) {
+    // keep the bounce buffers dividing the frame evenly
+    lines = ((lines + 7) / 8) * 8;
+    lcd.frame_lines = max(min(lines, lcd.display_lines), 8);
+    lcd.skipped_lines = min(lcd.skipped_lines, lcd.frame_lines - 8);
+}
+
+void epd_lcd_set_skipped_lines(int lines) {
+    lines = (max(lines, 0) / 8) * 8;
+    lcd.skipped_lines = min(lines, lcd.frame_lines - 8);
 }
 
 void IRAM_ATTR epd_lcd_start_frame() {
-    int initial_lines = min(LINE_BATCH, lcd.display_lines);
+    // with automatic depth, underruns in the last frame call for deeper bounce buffers
+    if (lcd.bb_auto && lcd.frame_underruns > 0 && lcd.bb_next_lines < lcd.bb_max_lines) {
+        lcd.bb_next_lines = lcd.bb_lines * 2;
+    }
+    lcd.frame_underruns = 0;
+    lcd.last_refill_us = 0;
+
+    int initial_lines = min(lcd.line_batch, lcd.frame_lines - lcd.skipped_lines);
 
     // hsync: pulse with, back porch, active width, front porch
     int end_line
@@ -668,20 +991,36 @@ void IRAM_ATTR epd_lcd_start_frame() {
     lcd_ll_stop(lcd.hal.dev);
     lcd_ll_fifo_reset(lcd.hal.dev);
     lcd_ll_enable_auto_next_frame(lcd.hal.dev, true);
+    apply_bounce_buffer_lines();
 
     lcd.batches = 0;
-    fill_bounce_buffer(lcd.bounce_buffer[0]);
-    fill_bounce_buffer(lcd.bounce_buffer[1]);
+    lcd.zero_copy = lcd.slot_nodes != NULL && lcd.line_slot_cb != NULL;
+    if (lcd.zero_copy) {
+        fill_line_slots(0);
+        fill_line_slots(1);
+    } else {
+        fill_bounce_buffer(lcd.bounce_buffer[0]);
+        fill_bounce_buffer(lcd.bounce_buffer[1]);
+    }
 
     // the start of DMA should be prior to the start of LCD engine
-    gdma_start(lcd.dma_chan, (intptr_t)&lcd.dma_nodes[0]);
+    dma_descriptor_t* first_node = lcd.zero_copy ? &lcd.slot_nodes[0] : &lcd.dma_nodes[0];
+    gdma_start(lcd.dma_chan, (intptr_t)first_node);
+
+    // Lines without data are passed quickly before the timing critical start.
+    // The vertical start pulse is already given then.
+    if (lcd.skipped_lines > 0) {
+        skip_frame_lines();
+    }
 
     // enter a critical section to ensure the frame start timing is correct
     taskENTER_CRITICAL(&frame_start_spinlock);
 
     // delay 1us is sufficient for DMA to pass data to LCD FIFO
     // in fact, this is only needed when LCD pixel clock is set too high
-    gpio_set_level(lcd.config.bus.stv, 0);
+    if (lcd.skipped_lines == 0) {
+        gpio_set_level(lcd.config.bus.stv, 0);
+    }
     // esp_rom_delay_us(1);
     //  for picture clarity, it seems to be important to start CKV at a "good"
     //  time, seemingly start or towards end of line.
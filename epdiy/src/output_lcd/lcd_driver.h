@@ -25,26 +25,89 @@ typedef struct {
     gpio_num_t stv;
 } lcd_bus_config_t;
 
+/// Let the driver choose the bounce buffer depth from the line timing.
+#define EPD_LCD_BOUNCE_LINES_AUTO -1
+
 /// Configuration structure for the LCD-based Epd driver.
 typedef struct {
     // high time for CKV in 1/10us.
-    size_t pixel_clock;    // = 12000000
-    int ckv_high_time;     // = 70
-    int line_front_porch;  // = 4
-    int le_high_time;      // = 4
-    int bus_width;         // = 16
+    size_t pixel_clock;       // = 12000000
+    int ckv_high_time;        // = 70
+    int line_front_porch;     // = 4
+    int le_high_time;         // = 4
+    int bus_width;            // = 16
     lcd_bus_config_t bus;
+    // let the DMA read lines in place if a line slot source is set,
+    // instead of copying them to the bounce buffers.
+    bool zero_copy;           // = false
+    // lines per bounce buffer, must be 1, 2, 4 or 8. 0 selects the default,
+    // EPD_LCD_BOUNCE_LINES_AUTO the smallest depth that keeps up with the pixel clock.
+    int bounce_buffer_lines;  // = 4
+    // lines output per run of the LCD peripheral, at most 1000. 0 selects the default.
+    int line_batch;           // = 1000
 } LcdEpdConfig_t;
 
+/// Line output statistics of the LCD driver, since init or the last reset.
+typedef struct {
+    /// Number of frames output.
+    uint32_t frames;
+    /// Number of bounce buffer (or line slot) refills.
+    uint32_t refills;
+    /// Number of refills which finished after the DMA must have reached the buffer again.
+    uint32_t underruns;
+    /// Longest refill in microseconds.
+    uint32_t max_refill_us;
+    /// Total time spent in refills in microseconds.
+    uint32_t total_refill_us;
+    /// Current number of lines per bounce buffer.
+    int bounce_buffer_lines;
+    /// Current number of lines per run of the LCD peripheral.
+    int line_batch;
+} LcdEpdStats_t;
+
 typedef bool (*line_cb_func_t)(void*, uint8_t*);
 typedef void (*frame_done_func_t)(void*);
+/// Return the next line to output in place, or NULL for an empty line.
+/// The line must stay unchanged until it is released.
+typedef const uint8_t* (*line_slot_func_t)(void*);
+/// Release a line returned by the line slot function after the DMA read it.
+/// Lines are released in the order they were returned.
+typedef void (*line_release_func_t)(void*, const uint8_t*);
 
 void epd_lcd_init(const LcdEpdConfig_t* config, int display_width, int display_height);
 void epd_lcd_deinit();
 void epd_lcd_frame_done_cb(frame_done_func_t, void* payload);
 void epd_lcd_line_source_cb(line_cb_func_t, void* payload);
+/**
+ * Set a zero-copy line source, used instead of the line source callback
+ * if `zero_copy` is enabled in the configuration.
+ * Lines must be in DMA capable memory and 4 byte aligned.
+ */
+void epd_lcd_line_slot_cb(line_slot_func_t slot, line_release_func_t release, void* payload);
 void epd_lcd_start_frame();
+/**
+ * Set the number of lines clocked out by subsequent frames, starting from the top.
+ * Lines below are not driven at all, which shortens frames for updates that end early.
+ * The value is rounded up to a multiple of 8 and capped at the display height.
+ */
+void epd_lcd_set_frame_lines(int lines);
+/**
+ * Set the number of lines at the top of subsequent frames which are skipped
+ * with fast CKV pulses, without clocking out line data.
+ * The first line requested from the line source is then the first line after them.
+ * The value is rounded down to a multiple of 8, at least 8 lines of the frame remain.
+ */
+void epd_lcd_set_skipped_lines(int lines);
 /**
  * Set the LCD pixel clock frequency in MHz.
+ * With an automatic bounce buffer depth, the depth is chosen again for the new clock.
  */
 void epd_lcd_set_pixel_clock_MHz(int frequency);
+/**
+ * Get the line output statistics.
+ */
+void epd_lcd_get_stats(LcdEpdStats_t* stats);
+/**
+ * Reset the line output statistics.
+ */
+void epd_lcd_reset_stats();
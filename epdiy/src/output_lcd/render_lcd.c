@@ -25,19 +25,46 @@
 // declare vector optimized line mask application.
 void epd_apply_line_mask_VE(uint8_t* line, const uint8_t* mask, int mask_len);
 
+/**
+ * Apply an output line mask of `mask_len` bytes.
+ * The vector routine only covers whole blocks of 16 bytes, the rest is masked here.
+ */
+static inline void apply_line_mask(uint8_t* line, const uint8_t* mask, int mask_len) {
+    int vector_len = mask_len / 16 * 16;
+    epd_apply_line_mask_VE(line, mask, vector_len);
+    for (int i = vector_len; i < mask_len; i++) {
+        line[i] &= mask[i];
+    }
+}
+
+// declare line interlacing for on-the-fly difference calculation.
+bool _epd_interlace_line(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int fb_width
+);
+bool _epd_interlace_line_2bpp(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int fb_width
+);
+
 __attribute__((optimize("O3"))) static bool IRAM_ATTR
 retrieve_line_isr(RenderContext_t* ctx, uint8_t* buf) {
     if (ctx->lines_consumed >= ctx->lines_total) {
+        memset(buf, 0x00, ctx->display_width / 4);
         return false;
     }
     int thread = ctx->line_threads[ctx->lines_consumed];
-    assert(thread < NUM_RENDER_THREADS);
-
-    LineQueue_t* lq = &ctx->line_queues[thread];
 
     BaseType_t awoken = pdFALSE;
 
-    if (lq_read(lq, buf) != 0) {
+    // no render thread started the line yet, or its queue is empty
+    if (thread >= ctx->num_threads || lq_read(&ctx->line_queues[thread], buf) != 0) {
         ctx->error |= EPD_DRAW_EMPTY_LINE_QUEUE;
         memset(buf, 0x00, ctx->display_width / 4);
     }
@@ -49,10 +76,51 @@ retrieve_line_isr(RenderContext_t* ctx, uint8_t* buf) {
     return awoken;
 }
 
+/// Like `retrieve_line_isr`, but the line is output in place from the line queue.
+__attribute__((optimize("O3"))) static const uint8_t* IRAM_ATTR
+retrieve_line_slot_isr(RenderContext_t* ctx) {
+    if (ctx->lines_consumed >= ctx->lines_total) {
+        return NULL;
+    }
+    int thread = ctx->line_threads[ctx->lines_consumed];
+
+    const uint8_t* line = NULL;
+    if (thread < ctx->num_threads) {
+        line = lq_reserve(&ctx->line_queues[thread]);
+    }
+    if (line == NULL) {
+        ctx->error |= EPD_DRAW_EMPTY_LINE_QUEUE;
+    }
+    ctx->lines_consumed += 1;
+    return line;
+}
+
+/// Free a line output in place for the render thread that prepared it.
+static void IRAM_ATTR release_line_slot_isr(RenderContext_t* ctx, const uint8_t* line) {
+    for (int i = 0; i < ctx->num_threads; i++) {
+        LineQueue_t* lq = &ctx->line_queues[i];
+        if (lq->last != lq->reserved && lq->bufs[lq->last] == line) {
+            lq_release(lq);
+            return;
+        }
+    }
+}
+
+/// Set the line sources of the LCD driver, the driver decides which one to use.
+static void IRAM_ATTR set_line_sources(RenderContext_t* ctx) {
+    epd_lcd_line_source_cb((line_cb_func_t)&retrieve_line_isr, ctx);
+    epd_lcd_line_slot_cb(
+        (line_slot_func_t)&retrieve_line_slot_isr,
+        (line_release_func_t)&release_line_slot_isr,
+        ctx
+    );
+}
+
 /// start the next frame in the current update cycle
 static void IRAM_ATTR handle_lcd_frame_done(RenderContext_t* ctx) {
     epd_lcd_frame_done_cb(NULL, NULL);
     epd_lcd_line_source_cb(NULL, NULL);
+    epd_lcd_line_slot_cb(NULL, NULL, NULL);
 
     BaseType_t task_awoken = pdFALSE;
     xSemaphoreGiveFromISR(ctx->frame_done, &task_awoken);
@@ -60,34 +128,88 @@ static void IRAM_ATTR handle_lcd_frame_done(RenderContext_t* ctx) {
     portYIELD_FROM_ISR();
 }
 
-void lcd_do_update(RenderContext_t* ctx) {
-    epd_set_mode(1);
+/**
+ * Output one frame with the render threads preparing its lines.
+ * For the final frame of an update, the previous image of a difference update
+ * is copied back as soon as the render threads are done reading it.
+ */
+static void output_frame(RenderContext_t* ctx, bool final) {
+    epd_lcd_frame_done_cb((frame_done_func_t)handle_lcd_frame_done, ctx);
 
-    for (uint8_t k = 0; k < ctx->cycle_frames; k++) {
-        epd_lcd_frame_done_cb((frame_done_func_t)handle_lcd_frame_done, ctx);
-        prepare_context_for_next_frame(ctx);
+    // lines are assigned to the render threads as they start preparing them
+    memset(ctx->line_threads, 0xFF, ctx->lines_total);
 
-        // start both feeder tasks
-        xTaskNotifyGive(ctx->feed_tasks[!xPortGetCoreID()]);
-        xTaskNotifyGive(ctx->feed_tasks[xPortGetCoreID()]);
+    start_feed_tasks(ctx);
 
+    if (final) {
+        // The previous image is no longer read once the feeders are done,
+        // so it can be updated while the queued lines are still output.
+        for (int i = 0; i < ctx->num_threads; i++) {
+            xSemaphoreTake(ctx->feed_done_smphr[i], portMAX_DELAY);
+        }
+        copy_back_difference(ctx);
+        xSemaphoreTake(ctx->frame_done, portMAX_DELAY);
+    } else {
         // transmission is started in renderer threads, now wait util it's done
         xSemaphoreTake(ctx->frame_done, portMAX_DELAY);
 
-        for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+        for (int i = 0; i < ctx->num_threads; i++) {
             xSemaphoreTake(ctx->feed_done_smphr[i], portMAX_DELAY);
         }
+    }
+}
+
+static void end_update() {
+    epd_lcd_line_source_cb(NULL, NULL);
+    epd_lcd_line_slot_cb(NULL, NULL, NULL);
+    epd_lcd_frame_done_cb(NULL, NULL);
+    epd_lcd_set_skipped_lines(0);
+
+    epd_set_mode(0);
+}
+
+void lcd_do_update(RenderContext_t* ctx) {
+    // only clock out lines up to the last one that is drawn,
+    // and quickly skip the lines before the first one.
+    epd_lcd_set_frame_lines(ctx->lines_total);
+    epd_lcd_set_skipped_lines(ctx->lines_skipped);
+    epd_set_mode(1);
+
+    for (uint8_t k = 0; k < ctx->cycle_frames; k++) {
+        // frames that do not drive any pixel present
+        if (frame_is_skipped(ctx)) {
+            ctx->current_frame++;
+            continue;
+        }
 
+        prepare_context_for_next_frame(ctx);
+        output_frame(ctx, frame_is_final(ctx));
         ctx->current_frame++;
 
         // make the watchdog happy.
         vTaskDelay(0);
     }
 
-    epd_lcd_line_source_cb(NULL, NULL);
-    epd_lcd_frame_done_cb(NULL, NULL);
+    end_update();
+}
 
-    epd_set_mode(0);
+void lcd_do_region_update(RenderContext_t* ctx, bool (*next_frame)(RenderContext_t*)) {
+    if (!next_frame(ctx)) {
+        return;
+    }
+    epd_set_mode(1);
+
+    do {
+        // the line range changes as regions join and leave the update
+        epd_lcd_set_frame_lines(ctx->lines_total);
+        epd_lcd_set_skipped_lines(ctx->lines_skipped);
+        output_frame(ctx, false);
+
+        // make the watchdog happy.
+        vTaskDelay(0);
+    } while (next_frame(ctx));
+
+    end_update();
 }
 
 __attribute__((optimize("O3"))) static bool IRAM_ATTR
@@ -149,6 +271,7 @@ void epd_push_pixels_lcd(RenderContext_t* ctx, short time, int color) {
     assert(ctx->static_line_buffer != NULL);
 
     push_pixels_populate_line(ctx, color);
+    epd_lcd_set_frame_lines(ctx->display_height);
     epd_lcd_frame_done_cb((frame_done_func_t)handle_lcd_frame_done, ctx);
     epd_lcd_line_source_cb((line_cb_func_t)&push_pixels_isr, ctx);
 
@@ -161,6 +284,49 @@ void epd_push_pixels_lcd(RenderContext_t* ctx, short time, int color) {
     ctx->static_line_buffer = NULL;
 }
 
+/// Check if a line belongs to any of the update regions drawn in the current frame.
+static inline bool IRAM_ATTR region_line_drawn(const RenderContext_t* ctx, int l) {
+    for (int r = 0; r < EPD_MAX_UPDATE_REGIONS; r++) {
+        const EpdRect* area = &ctx->regions[r].area;
+        if ((ctx->regions_drawn & (1 << r)) && l >= area->y && l < area->y + area->height) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Look up an interlaced line with the LUT of each update region it belongs to,
+ * each masked to the columns of its region.
+ * With more than one region on the line, the results are merged via `scratch`.
+ */
+__attribute__((optimize("O3"))) static void IRAM_ATTR lookup_region_line(
+    RenderContext_t* ctx, int l, const uint32_t* lp, uint8_t* buf, uint8_t* scratch
+) {
+    int width = ctx->display_width;
+    bool first = true;
+    for (int r = 0; r < EPD_MAX_UPDATE_REGIONS; r++) {
+        const UpdateRegion_t* region = &ctx->regions[r];
+        if (!(ctx->regions_drawn & (1 << r)) || l < region->area.y
+            || l >= region->area.y + region->area.height) {
+            continue;
+        }
+
+        uint8_t* out = first ? buf : scratch;
+        ctx->lut_lookup_func(lp, out, region->lut, width);
+        apply_line_mask(out, region->line_mask, width / 4);
+
+        if (!first) {
+            uint32_t* merged = (uint32_t*)buf;
+            const uint32_t* line = (const uint32_t*)scratch;
+            for (int i = 0; i < width / 16; i++) {
+                merged[i] |= line[i];
+            }
+        }
+        first = false;
+    }
+}
+
 #define int_min(a, b) (((a) < (b)) ? (a) : (b))
 __attribute__((optimize("O3"))) void IRAM_ATTR
 lcd_calculate_frame(RenderContext_t* ctx, int thread_id) {
@@ -173,7 +339,7 @@ lcd_calculate_frame(RenderContext_t* ctx, int thread_id) {
     // if there is an error, start the frame but don't feed data.
     if (ctx->error) {
         memset(ctx->line_threads, 0, ctx->lines_total);
-        epd_lcd_line_source_cb((line_cb_func_t)&retrieve_line_isr, ctx);
+        set_line_sources(ctx);
         epd_lcd_start_frame();
         ESP_LOGW("epd_lcd", "draw frame draw initiated, but an error flag is set: %X", ctx->error);
         return;
@@ -189,22 +355,29 @@ lcd_calculate_frame(RenderContext_t* ctx, int thread_id) {
 
     assert(area.width == ctx->display_width && area.x == 0 && !ctx->error);
 
-    // index of the line that triggers the frame output when processed
-    int trigger_line = int_min(63, max_y - min_y);
+    // index of the line that triggers the frame output when processed.
+    // Lines above `min_y` are queued as well, except for the skipped ones.
+    // With a single thread, its queue limits the lines queued in advance.
+    int lines_ahead = int_min(64, ctx->num_threads * (lq->size - 1));
+    int trigger_line = int_min(ctx->lines_skipped + lines_ahead - 1, ctx->lines_total - 1);
 
     while (l = atomic_fetch_add(&ctx->lines_prepared, 1), l < ctx->lines_total) {
         ctx->line_threads[l] = thread_id;
 
         // queue is sufficiently filled to fill both bounce buffers, frame
         // can begin
-        if (l - min_y == trigger_line) {
-            epd_lcd_line_source_cb((line_cb_func_t)&retrieve_line_isr, ctx);
+        if (l == trigger_line) {
+            set_line_sources(ctx);
             epd_lcd_start_frame();
         }
 
         if (l < min_y || l >= max_y
-            || (ctx->drawn_lines != NULL && !ctx->drawn_lines[l - area.y])) {
-            uint8_t* buf = NULL;
+            || (ctx->drawn_lines != NULL && !ctx->drawn_lines[l - area.y])
+            || (ctx->regions_drawn != 0 && !region_line_drawn(ctx, l))) {
+            uint8_t* buf = lq_current(lq);
+            if (buf == NULL) {
+                ctx->feed_stats[thread_id].queue_stalls++;
+            }
             while (buf == NULL) {
                 // break in case of errors
                 if (ctx->error & EPD_DRAW_EMPTY_LINE_QUEUE) {
@@ -221,13 +394,40 @@ lcd_calculate_frame(RenderContext_t* ctx, int thread_id) {
         }
 
         uint32_t* lp = (uint32_t*)input_line;
-        const uint8_t* ptr = ptr_start + bytes_per_line * (l - min_y);
 
-        Cache_Start_DCache_Preload((uint32_t)ptr, ctx->display_width, 0);
-
-        lp = (uint32_t*)ptr;
+        if (ctx->diff_from_ptr != NULL && (ctx->mode & MODE_PACKING_4PPB)) {
+            size_t offset = (size_t)(l - area.y) * (ctx->display_width / 4);
+            _epd_interlace_line_2bpp(
+                ctx->data_ptr + offset,
+                ctx->diff_from_ptr + offset,
+                input_line,
+                ctx->feed_dirtyness_buffers[thread_id],
+                ctx->display_width
+            );
+        } else if (ctx->diff_from_ptr != NULL) {
+            // interlace goal and previous image into the internal line buffer,
+            // instead of reading a stored difference image.
+            size_t offset = (size_t)(l - area.y) * (ctx->display_width / 2);
+            const uint8_t* to = ctx->data_ptr + offset;
+            const uint8_t* from = ctx->diff_from_ptr + offset;
+
+            Cache_Start_DCache_Preload((uint32_t)to, ctx->display_width / 2, 0);
+
+            _epd_interlace_line(
+                to, from, input_line, ctx->feed_dirtyness_buffers[thread_id], ctx->display_width
+            );
+        } else {
+            const uint8_t* ptr = ptr_start + bytes_per_line * (l - min_y);
+
+            Cache_Start_DCache_Preload((uint32_t)ptr, ctx->display_width, 0);
+
+            lp = (uint32_t*)ptr;
+        }
 
-        uint8_t* buf = NULL;
+        uint8_t* buf = lq_current(lq);
+        if (buf == NULL) {
+            ctx->feed_stats[thread_id].queue_stalls++;
+        }
         while (buf == NULL) {
             // break in case of errors
             if (ctx->error & EPD_DRAW_EMPTY_LINE_QUEUE) {
@@ -239,10 +439,16 @@ lcd_calculate_frame(RenderContext_t* ctx, int thread_id) {
             buf = lq_current(lq);
         }
 
+        if (ctx->regions_drawn != 0) {
+            lookup_region_line(ctx, l, lp, buf, ctx->region_line_buffers[thread_id]);
+            lq_commit(lq);
+            continue;
+        }
+
         ctx->lut_lookup_func(lp, buf, ctx->conversion_lut, ctx->display_width);
 
         // apply the line mask
-        epd_apply_line_mask_VE(buf, ctx->line_mask, ctx->display_width / 4);
+        apply_line_mask(buf, ctx->line_mask, ctx->display_width / 4);
 
         lq_commit(lq);
     }
@@ -12,6 +12,12 @@ void epd_push_pixels_lcd(RenderContext_t* ctx, short time, int color);
  */
 void lcd_do_update(RenderContext_t* ctx);
 
+/**
+ * Draw frames of the concurrent update regions until `next_frame` returns false.
+ * `next_frame` prepares the context for each frame, including the first one.
+ */
+void lcd_do_region_update(RenderContext_t* ctx, bool (*next_frame)(RenderContext_t*));
+
 /**
  * Worker thread for output calculation.
  * In LCD mode, both threads do the same thing.
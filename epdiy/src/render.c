@@ -26,6 +26,10 @@
 #include "output_i2s/render_i2s.h"
 #include "output_lcd/render_lcd.h"
 
+#ifdef RENDER_METHOD_LCD
+#include "output_lcd/lcd_driver.h"
+#endif
+
 static inline int min(int x, int y) {
     return x < y ? x : y;
 }
@@ -45,13 +49,176 @@ const int clear_cycle_time = 12;
 
 static RenderContext_t render_context;
 
+/// Held by an update or difference calculation using the render threads and the display.
+static SemaphoreHandle_t render_mutex = NULL;
+
+#ifdef RENDER_METHOD_LCD
+/// Protects the state of the update regions.
+static SemaphoreHandle_t region_mutex = NULL;
+/// Task drawing the frames of the update regions, created on first use.
+static TaskHandle_t region_task = NULL;
+/// Framebuffers shared by the active update regions.
+static const uint8_t* region_to = NULL;
+static uint8_t* region_from = NULL;
+
+static void deinit_regions();
+#endif
+
+static EpdRenderThreadConfig render_thread_config = {
+    .num_threads = NUM_RENDER_THREADS,
+    .priority = configMAX_PRIORITIES - 1,
+    .core = { 0, 1 },
+};
+
+void epd_set_render_thread_config(const EpdRenderThreadConfig* config) {
+    assert(render_context.feed_tasks[0] == NULL);
+    assert(config->num_threads >= 1 && config->num_threads <= NUM_RENDER_THREADS);
+    render_thread_config = *config;
+}
+
+EpdRenderThreadConfig epd_get_render_thread_config() {
+    return render_thread_config;
+}
+
 void epd_push_pixels(EpdRect area, short time, int color) {
+    xSemaphoreTake(render_mutex, portMAX_DELAY);
     render_context.area = area;
 #ifdef RENDER_METHOD_LCD
     epd_push_pixels_lcd(&render_context, time, color);
 #else
     epd_push_pixels_i2s(&render_context, area, time, color);
 #endif
+    xSemaphoreGive(render_mutex);
+}
+
+///////////////////////////// Statistics ///////////////////////////////
+
+/// Performance counters of the most recent updates, a ring buffer.
+static EpdUpdateStats update_stats[EPD_UPDATE_STATS_LEN];
+/// Index of the entry of `update_stats` written next.
+static int update_stats_next = 0;
+/// Number of valid entries in `update_stats`.
+static int update_stats_count = 0;
+/// Time spent calculating differences since the last recorded update.
+static uint32_t pending_diff_us = 0;
+/// Protects the counters, which are read and written by different tasks.
+static portMUX_TYPE update_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#ifdef RENDER_METHOD_LCD
+/// LCD driver statistics at the start of the current update.
+static LcdEpdStats_t lcd_stats_before;
+#endif
+
+static void add_diff_time(int64_t start_us) {
+    uint32_t diff_us = esp_timer_get_time() - start_us;
+    taskENTER_CRITICAL(&update_stats_lock);
+    pending_diff_us += diff_us;
+    taskEXIT_CRITICAL(&update_stats_lock);
+}
+
+static inline bool column_drawn(const uint8_t* drawn_columns, int x) {
+    return (drawn_columns[x / 2] >> (4 * (x % 2))) & 0x0F;
+}
+
+/// Bounding box of the lines and columns drawn by the current update, in display coordinates.
+static EpdRect drawn_area(const RenderContext_t* ctx, bool crop) {
+    EpdRect area = ctx->area;
+    if (crop) {
+        area.x += ctx->crop_to.x;
+        area.y += ctx->crop_to.y;
+        area.width = ctx->crop_to.width;
+        area.height = ctx->crop_to.height;
+    }
+    int x_start = max(area.x, 0);
+    int x_end = min(area.x + area.width, ctx->display_width);
+    int y_start = max(area.y, 0);
+    int y_end = min(area.y + area.height, ctx->display_height);
+
+    if (ctx->drawn_lines != NULL) {
+        while (y_start < y_end && !ctx->drawn_lines[y_start - ctx->area.y]) {
+            y_start++;
+        }
+        while (y_end > y_start && !ctx->drawn_lines[y_end - 1 - ctx->area.y]) {
+            y_end--;
+        }
+    }
+    if (ctx->drawn_columns != NULL) {
+        while (x_start < x_end && !column_drawn(ctx->drawn_columns, x_start - ctx->area.x)) {
+            x_start++;
+        }
+        while (x_end > x_start && !column_drawn(ctx->drawn_columns, x_end - 1 - ctx->area.x)) {
+            x_end--;
+        }
+    }
+
+    EpdRect drawn = {
+        .x = x_start,
+        .y = y_start,
+        .width = max(x_end - x_start, 0),
+        .height = max(y_end - y_start, 0),
+    };
+    return drawn;
+}
+
+/// Reset the counters of the render threads and drivers before an update.
+static void begin_update_stats(RenderContext_t* ctx, EpdUpdateStats* stats) {
+    memset(ctx->feed_stats, 0, sizeof(ctx->feed_stats));
+#ifdef RENDER_METHOD_LCD
+    epd_lcd_get_stats(&lcd_stats_before);
+#endif
+    stats->timestamp_us = esp_timer_get_time();
+    stats->mode = ctx->mode;
+}
+
+/// Collect the counters of an update drawn with the render context into the ring buffer.
+static void record_update_stats(const RenderContext_t* ctx, EpdUpdateStats* stats, bool crop) {
+    stats->draw_us = esp_timer_get_time() - stats->timestamp_us;
+    for (int frame = 0; frame < ctx->cycle_frames; frame++) {
+        if (frame < 256 && ctx->skipped_frames[frame / 32] & (1 << (frame % 32))) {
+            stats->skipped_frames++;
+        }
+    }
+    stats->frames = ctx->cycle_frames - stats->skipped_frames;
+    for (int i = 0; i < ctx->num_threads; i++) {
+        stats->feed_us += ctx->feed_stats[i].feed_us;
+        stats->max_feed_us = max(stats->max_feed_us, ctx->feed_stats[i].max_feed_us);
+        stats->queue_stalls += ctx->feed_stats[i].queue_stalls;
+    }
+#ifdef RENDER_METHOD_LCD
+    LcdEpdStats_t lcd_stats;
+    epd_lcd_get_stats(&lcd_stats);
+    stats->isr_us = lcd_stats.total_refill_us - lcd_stats_before.total_refill_us;
+    stats->underruns = lcd_stats.underruns - lcd_stats_before.underruns;
+#endif
+    stats->dirty_area = drawn_area(ctx, crop);
+    stats->error = ctx->error;
+
+    taskENTER_CRITICAL(&update_stats_lock);
+    stats->diff_us = pending_diff_us;
+    pending_diff_us = 0;
+    update_stats[update_stats_next] = *stats;
+    update_stats_next = (update_stats_next + 1) % EPD_UPDATE_STATS_LEN;
+    update_stats_count = min(update_stats_count + 1, EPD_UPDATE_STATS_LEN);
+    taskEXIT_CRITICAL(&update_stats_lock);
+}
+
+int epd_get_update_stats(EpdUpdateStats* stats, int max_stats) {
+    taskENTER_CRITICAL(&update_stats_lock);
+    int count = min(update_stats_count, max_stats);
+    for (int i = 0; i < count; i++) {
+        int index = (update_stats_next - 1 - i + EPD_UPDATE_STATS_LEN) % EPD_UPDATE_STATS_LEN;
+        stats[i] = update_stats[index];
+    }
+    taskEXIT_CRITICAL(&update_stats_lock);
+    return count;
+}
+
+void epd_reset_update_stats() {
+    taskENTER_CRITICAL(&update_stats_lock);
+    update_stats_next = 0;
+    update_stats_count = 0;
+    pending_diff_us = 0;
+    taskEXIT_CRITICAL(&update_stats_lock);
 }
 
 ///////////////////////////// Coordination ///////////////////////////////
@@ -89,18 +256,54 @@ static inline int rounded_display_height() {
     return (((epd_height() + 7) / 8) * 8);
 }
 
+/**
+ * Number of lines that need to be output for a draw, counted from the top.
+ * Lines below the (cropped) area are not driven at all.
+ * Rounded up like the display height, for even division into multi-line buffers.
+ */
+static inline int drawn_lines_total(EpdRect area, EpdRect crop_to, bool crop) {
+    int end = crop ? area.y + crop_to.y + crop_to.height : area.y + area.height;
+    end = min(max(end, 1), epd_height());
+    return min(((end + 7) / 8) * 8, rounded_display_height());
+}
+
+/**
+ * Number of lines at the top of the frame before the first drawn line,
+ * rounded down to a multiple of 8 and leaving at least 8 lines to draw.
+ */
+static inline int skipped_lines_total(
+    EpdRect area, EpdRect crop_to, bool crop, const bool* drawn_lines, int lines_total
+) {
+#ifdef RENDER_METHOD_LCD
+    int first = max(crop ? area.y + crop_to.y : area.y, 0);
+    if (drawn_lines != NULL) {
+        int end = min(lines_total, area.y + area.height);
+        while (first < end && !drawn_lines[first - area.y]) {
+            first++;
+        }
+    }
+    return max(min((first / 8) * 8, lines_total - 8), 0);
+#else
+    return 0;
+#endif
+}
+
 // FIXME: fix misleading naming:
 //  area -> buffer dimensions
 //  crop -> area taken out of buffer
-enum EpdDrawError IRAM_ATTR epd_draw_base(
+static enum EpdDrawError IRAM_ATTR draw_base(
     EpdRect area,
     const uint8_t* data,
+    const uint8_t* diff_from,
     EpdRect crop_to,
     enum EpdDrawMode mode,
     int temperature,
     const bool* drawn_lines,
     const uint8_t* drawn_columns,
-    const EpdWaveform* waveform
+    const EpdWaveform* waveform,
+    const EpdTransitionHistogram* transitions,
+    uint8_t* copy_back_to,
+    const EpdRect* copy_back
 ) {
     if (waveform == NULL) {
         return EPD_DRAW_NO_PHASES_AVAILABLE;
@@ -154,6 +357,9 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
         return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
     }
 
+    // wait for active update regions to complete
+    xSemaphoreTake(render_mutex, portMAX_DELAY);
+
     render_context.area = area;
     render_context.crop_to = crop_to;
     render_context.waveform_range = waveform_range;
@@ -162,13 +368,23 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
     render_context.waveform = waveform;
     render_context.error = EPD_DRAW_SUCCESS;
     render_context.drawn_lines = drawn_lines;
+    render_context.drawn_columns = drawn_columns;
     render_context.data_ptr = data;
+    render_context.diff_from_ptr = diff_from;
+    render_context.copy_back_ptr = copy_back_to;
+    if (copy_back != NULL) {
+        render_context.copy_back = *copy_back;
+    }
     render_context.lut_build_func = lut_functions.build_func;
     render_context.lut_lookup_func = lut_functions.lookup_func;
+    render_context.lut_build_size = lut_functions.build_size;
 
     render_context.lines_prepared = 0;
     render_context.lines_consumed = 0;
-    render_context.lines_total = rounded_display_height();
+    render_context.lines_total = drawn_lines_total(area, crop_to, crop);
+    render_context.lines_skipped = skipped_lines_total(
+        area, crop_to, crop, drawn_lines, render_context.lines_total
+    );
     render_context.current_frame = 0;
     render_context.cycle_frames = frame_count;
     render_context.phase_times = NULL;
@@ -176,6 +392,11 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
         render_context.phase_times = waveform_phases->phase_times;
     }
 
+    mark_skipped_frames(&render_context, transitions);
+
+    EpdUpdateStats stats = { .temperature = temperature };
+    begin_update_stats(&render_context, &stats);
+
     epd_populate_line_mask(
         render_context.line_mask, drawn_columns, render_context.display_width / 4
     );
@@ -185,23 +406,99 @@ enum EpdDrawError IRAM_ATTR epd_draw_base(
 #elif defined(RENDER_METHOD_LCD)
     lcd_do_update(&render_context);
 #endif
+    // in case it did not happen during the last frame
+    copy_back_difference(&render_context);
+    record_update_stats(&render_context, &stats, crop);
+
+    enum EpdDrawError err = render_context.error;
+    xSemaphoreGive(render_mutex);
 
-    if (render_context.error & EPD_DRAW_EMPTY_LINE_QUEUE) {
+    if (err & EPD_DRAW_EMPTY_LINE_QUEUE) {
         ESP_LOGE("epdiy", "line buffer underrun occurred!");
     }
 
-    if (render_context.error != EPD_DRAW_SUCCESS) {
-        return render_context.error;
+    if (err != EPD_DRAW_SUCCESS) {
+        return err;
     }
     return EPD_DRAW_SUCCESS;
 }
 
+enum EpdDrawError IRAM_ATTR epd_draw_base(
+    EpdRect area,
+    const uint8_t* data,
+    EpdRect crop_to,
+    enum EpdDrawMode mode,
+    int temperature,
+    const bool* drawn_lines,
+    const uint8_t* drawn_columns,
+    const EpdWaveform* waveform
+) {
+    return draw_base(
+        area,
+        data,
+        NULL,
+        crop_to,
+        mode,
+        temperature,
+        drawn_lines,
+        drawn_columns,
+        waveform,
+        NULL,
+        NULL,
+        NULL
+    );
+}
+
+enum EpdDrawError epd_draw_difference_base(
+    EpdRect area,
+    const uint8_t* to,
+    uint8_t* from,
+    EpdRect crop_to,
+    enum EpdDrawMode mode,
+    int temperature,
+    const bool* drawn_lines,
+    const uint8_t* drawn_columns,
+    const EpdWaveform* waveform,
+    const EpdTransitionHistogram* transitions,
+    const EpdRect* copy_back
+) {
+#ifdef RENDER_METHOD_LCD
+    assert((uint32_t)to % 16 == 0);
+    assert((uint32_t)from % 16 == 0);
+    return draw_base(
+        area,
+        to,
+        from,
+        crop_to,
+        MODE_PACKING_1PPB_DIFFERENCE | mode,
+        temperature,
+        drawn_lines,
+        drawn_columns,
+        waveform,
+        transitions,
+        copy_back != NULL ? from : NULL,
+        copy_back
+    );
+#else
+    return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
+#endif
+}
+
+static void difference_lines(const DiffJob_t* job, int thread_id, int num_threads);
+
 static void IRAM_ATTR render_thread(void* arg) {
     int thread_id = (int)arg;
 
     while (true) {
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
+        if (render_context.diff_job != NULL) {
+            difference_lines(render_context.diff_job, thread_id, render_context.num_threads);
+            xSemaphoreGive(render_context.feed_done_smphr[thread_id]);
+            continue;
+        }
+
+        int64_t start_us = esp_timer_get_time();
 #ifdef RENDER_METHOD_LCD
         lcd_calculate_frame(&render_context, thread_id);
 #elif defined(RENDER_METHOD_I2S)
@@ -211,6 +508,10 @@ static void IRAM_ATTR render_thread(void* arg) {
             i2s_output_frame(&render_context, thread_id);
         }
 #endif
+        FeedStats_t* feed_stats = &render_context.feed_stats[thread_id];
+        uint32_t feed_us = esp_timer_get_time() - start_us;
+        feed_stats->feed_us += feed_us;
+        feed_stats->max_feed_us = max(feed_stats->max_feed_us, feed_us);
 
         xSemaphoreGive(render_context.feed_done_smphr[thread_id]);
     }
@@ -248,6 +549,15 @@ void epd_renderer_init(enum EpdInitOptions options) {
     render_context.display_width = epd_width();
     render_context.display_height = epd_height();
 
+    render_context.num_threads = render_thread_config.num_threads;
+#ifdef RENDER_METHOD_I2S
+    // one thread fetches line data, the other one outputs it
+    if (render_context.num_threads != 2) {
+        ESP_LOGW("epd", "the I2S render method needs 2 render threads, using 2.");
+        render_context.num_threads = 2;
+    }
+#endif
+
     size_t lut_size = 0;
     if (options & EPD_LUT_1K) {
         lut_size = 1 << 10;
@@ -275,8 +585,12 @@ void epd_renderer_init(enum EpdInitOptions options) {
     render_context.static_line_buffer = NULL;
 
     render_context.frame_done = xSemaphoreCreateBinary();
+    render_mutex = xSemaphoreCreateMutex();
+#ifdef RENDER_METHOD_LCD
+    region_mutex = xSemaphoreCreateMutex();
+#endif
 
-    for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+    for (int i = 0; i < render_context.num_threads; i++) {
         render_context.feed_done_smphr[i] = xSemaphoreCreateBinary();
     }
 
@@ -292,6 +606,11 @@ void epd_renderer_init(enum EpdInitOptions options) {
     } else if (options & EPD_FEED_QUEUE_8) {
         queue_len = 8;
     }
+    // a single thread must queue enough lines to fill the output buffers on its own
+    if (render_context.num_threads == 1 && queue_len < 32) {
+        ESP_LOGW("epd", "a single render thread needs a feed queue of 32 lines, using 32.");
+        queue_len = 32;
+    }
 
     if (render_context.conversion_lut == NULL) {
         ESP_LOGE("epd", "could not allocate line mask!");
@@ -308,20 +627,26 @@ void epd_renderer_init(enum EpdInitOptions options) {
     size_t queue_elem_size = render_context.display_width;
 #endif
 
-    for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+    for (int i = 0; i < render_context.num_threads; i++) {
         render_context.line_queues[i] = lq_init(queue_len, queue_elem_size);
-        render_context.feed_line_buffers[i] = (uint8_t*)heap_caps_malloc(
-            render_context.display_width, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL
+        render_context.feed_line_buffers[i] = (uint8_t*)heap_caps_aligned_alloc(
+            16, render_context.display_width, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL
         );
         assert(render_context.feed_line_buffers[i] != NULL);
+        render_context.feed_dirtyness_buffers[i] = (uint8_t*)heap_caps_aligned_alloc(
+            16, render_context.display_width / 2, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL
+        );
+        assert(render_context.feed_dirtyness_buffers[i] != NULL);
+        int core = render_thread_config.core[i];
+        render_context.feed_task_cores[i] = core;
         RTOS_ERROR_CHECK(xTaskCreatePinnedToCore(
             render_thread,
             "epd_prep",
             1 << 12,
             (void*)i,
-            configMAX_PRIORITIES - 1,
+            render_thread_config.priority,
             &render_context.feed_tasks[i],
-            i
+            core == EPD_RENDER_ANY_CORE ? tskNO_AFFINITY : core
         ));
     }
 }
@@ -331,10 +656,17 @@ void epd_renderer_deinit() {
 
     epd_board->poweroff(epd_ctrl_state());
 
-    for (int i = 0; i < NUM_RENDER_THREADS; i++) {
+#ifdef RENDER_METHOD_LCD
+    deinit_regions();
+    vSemaphoreDelete(region_mutex);
+#endif
+
+    for (int i = 0; i < render_context.num_threads; i++) {
         vTaskDelete(render_context.feed_tasks[i]);
         lq_free(&render_context.line_queues[i]);
+        render_context.feed_tasks[i] = NULL;
         heap_caps_free(render_context.feed_line_buffers[i]);
+        heap_caps_free(render_context.feed_dirtyness_buffers[i]);
         vSemaphoreDelete(render_context.feed_done_smphr[i]);
     }
 
@@ -349,9 +681,11 @@ void epd_renderer_deinit() {
     }
 
     heap_caps_free(render_context.conversion_lut);
+    epd_lut_cache_clear();
     heap_caps_free(render_context.line_threads);
     heap_caps_free(render_context.line_mask);
     vSemaphoreDelete(render_context.frame_done);
+    vSemaphoreDelete(render_mutex);
 }
 
 #ifdef RENDER_METHOD_LCD
@@ -411,6 +745,11 @@ __attribute__((optimize("O3"))) bool _epd_interlace_line(
     int unaligned_back_start_px = fb_width - unaligned_len_back_px;
     int aligned_len_px = fb_width - unaligned_len_front_px - unaligned_len_back_px;
 
+    // The line does not contain a complete 16 byte block for the vector routine.
+    if (aligned_len_px <= 0) {
+        return _interlace_line_unaligned(to, from, interlaced, col_dirtyness, fb_width) > 0;
+    }
+
     dirty |= _interlace_line_unaligned(to, from, interlaced, col_dirtyness, unaligned_len_front_px);
     dirty |= epd_interlace_4bpp_line_VE(
         to + unaligned_len_front_px / 2,
@@ -430,17 +769,129 @@ __attribute__((optimize("O3"))) bool _epd_interlace_line(
 #endif
 }
 
-EpdRect epd_difference_image_base(
+/// Gray levels of the pixel values of framebuffers with 2 bits per pixel.
+static const uint8_t gray_levels_2bpp[4] = { 0x0, 0x5, 0xA, 0xF };
+
+/**
+ * Like `_epd_interlace_line()`, for lines of 2 bits per pixel (`MODE_PACKING_4PPB`).
+ */
+__attribute__((optimize("O3"))) bool _epd_interlace_line_2bpp(
+    const uint8_t* to,
+    const uint8_t* from,
+    uint8_t* interlaced,
+    uint8_t* col_dirtyness,
+    int fb_width
+) {
+    uint8_t dirty = 0;
+    for (int b = 0; b < fb_width / 4; b++) {
+        uint8_t t = to[b];
+        uint8_t f = from[b];
+        for (int k = 0; k < 4; k++) {
+            uint8_t t_level = gray_levels_2bpp[(t >> (2 * k)) & 0x3];
+            uint8_t f_level = gray_levels_2bpp[(f >> (2 * k)) & 0x3];
+            interlaced[4 * b + k] = (t_level << 4) | f_level;
+            col_dirtyness[2 * b + k / 2] |= (t_level ^ f_level) << (4 * (k % 2));
+        }
+        dirty |= t ^ f;
+    }
+    return dirty != 0;
+}
+
+/// Number of lines per band of a difference calculation handed to one render thread.
+/// Equal to the dirty tile size, so a thread looks up each tile row only once.
+#define DIFF_BAND_LINES EPD_DIRTY_TILE_SIZE
+
+/**
+ * Calculate the difference of the line bands assigned to `thread_id`,
+ * which are every `num_threads`th band of `DIFF_BAND_LINES` lines.
+ * With a dirty tile map, only the runs of tiles marked in a tile row are
+ * interlaced, and rows without marked tiles are skipped entirely.
+ */
+static void difference_lines(const DiffJob_t* job, int thread_id, int num_threads) {
+    int fb_width = job->fb_width;
+    uint8_t* col_dirtyness = job->col_dirtyness[thread_id];
+    uint8_t* scratch_line = job->scratch_lines[thread_id];
+    if (thread_id > 0) {
+        memset(col_dirtyness, 0, fb_width / 2);
+    }
+
+    int x_end = min(fb_width, job->crop_to.x + job->crop_to.width);
+    int y_end = job->crop_to.y + job->crop_to.height;
+
+    int tile_columns = (fb_width + EPD_DIRTY_TILE_SIZE - 1) / EPD_DIRTY_TILE_SIZE;
+    int first_tile = max(job->crop_to.x, 0) / EPD_DIRTY_TILE_SIZE;
+    int last_tile = (x_end - 1) / EPD_DIRTY_TILE_SIZE;
+
+    // Pixel pairs share a byte, so the interlaced range starts and ends at even pixels.
+    // Scratch lines are interlaced in whole 16 byte blocks of the input for the vector
+    // routines, the extra columns are cleared from the column dirtyness afterwards.
+    int align = job->interlaced == NULL ? 32 : 2;
+    int crop_start = max(job->crop_to.x, 0) / align * align;
+    int crop_end = min((x_end + align - 1) / align * align, fb_width);
+
+    int first_band = max(job->crop_to.y, 0) / DIFF_BAND_LINES;
+    for (int band = first_band + thread_id; band * DIFF_BAND_LINES < y_end; band += num_threads) {
+        // interlaced pixel range of the band, in pixels
+        int segment_start = crop_start;
+        int segment_end = crop_end;
+        if (job->dirty_tiles != NULL) {
+            const uint8_t* tile_row = job->dirty_tiles + band * tile_columns;
+            int first = first_tile;
+            int last = last_tile;
+            while (first <= last && !tile_row[first])
+                first++;
+            while (last >= first && !tile_row[last])
+                last--;
+            // whole tiles, which keeps the segments aligned to 16 byte blocks;
+            // tiles at the edges may extend beyond the crop, which is applied
+            // through the column dirtyness
+            segment_start = first * EPD_DIRTY_TILE_SIZE;
+            segment_end = min((last + 1) * EPD_DIRTY_TILE_SIZE, fb_width);
+        }
+
+        int y_start = max(band * DIFF_BAND_LINES, job->crop_to.y);
+        int band_end = min((band + 1) * DIFF_BAND_LINES, y_end);
+        for (int y = y_start; y < band_end; y++) {
+            if (segment_end <= segment_start) {
+                job->dirty_lines[y] = false;
+                continue;
+            }
+
+            uint32_t offset = y * fb_width / 2;
+            uint8_t* interlaced_line = scratch_line ? scratch_line : job->interlaced + offset * 2;
+            int dirty = _epd_interlace_line(
+                job->to + offset + segment_start / 2,
+                job->from + offset + segment_start / 2,
+                interlaced_line + segment_start,
+                col_dirtyness + segment_start / 2,
+                segment_end - segment_start
+            );
+            job->dirty_lines[y] = dirty;
+        }
+    }
+}
+
+/**
+ * Difference calculation shared by the public variants.
+ * A dirty tile map requires `interlaced` to be NULL, as lines of an
+ * output buffer would only be partially written.
+ *
+ * If the renderer is running, the line bands are split across the render threads,
+ * which are idle between updates.
+ */
+static EpdRect difference_image(
     const uint8_t* to,
     const uint8_t* from,
     EpdRect crop_to,
     int fb_width,
     int fb_height,
+    const uint8_t* dirty_tiles,
     uint8_t* interlaced,
     bool* dirty_lines,
     uint8_t* col_dirtyness
 ) {
     assert(fb_width % 8 == 0);
+    assert(dirty_tiles == NULL || interlaced == NULL);
     assert(col_dirtyness != NULL);
 
     // these buffers should be allocated 16 byte aligned
@@ -449,18 +900,69 @@ EpdRect epd_difference_image_base(
     assert((uint32_t)col_dirtyness % 16 == 0);
     assert((uint32_t)interlaced % 16 == 0);
 
+    int64_t start_us = esp_timer_get_time();
     memset(col_dirtyness, 0, fb_width / 2);
     memset(dirty_lines, 0, sizeof(bool) * fb_height);
 
     int x_end = min(fb_width, crop_to.x + crop_to.width);
     int y_end = min(fb_height, crop_to.y + crop_to.height);
 
-    for (int y = crop_to.y; y < y_end; y++) {
-        uint32_t offset = y * fb_width / 2;
-        int dirty = _epd_interlace_line(
-            to + offset, from + offset, interlaced + offset * 2, col_dirtyness, fb_width
-        );
-        dirty_lines[y] = dirty;
+    DiffJob_t job = {
+        .to = to,
+        .from = from,
+        .crop_to = crop_to,
+        .fb_width = fb_width,
+        .dirty_tiles = dirty_tiles,
+        .interlaced = interlaced,
+        .dirty_lines = dirty_lines,
+    };
+    job.crop_to.height = y_end - crop_to.y;
+    job.col_dirtyness[0] = col_dirtyness;
+
+    // While the render threads are busy drawing, calculate the difference on this task.
+    bool parallel = render_context.feed_tasks[0] != NULL
+                    && fb_width <= render_context.display_width
+                    && xSemaphoreTake(render_mutex, 0) == pdTRUE;
+    if (parallel) {
+        for (int i = 0; i < render_context.num_threads; i++) {
+            if (i > 0) {
+                job.col_dirtyness[i] = render_context.feed_dirtyness_buffers[i];
+            }
+            job.scratch_lines[i] = interlaced ? NULL : render_context.feed_line_buffers[i];
+        }
+
+        render_context.diff_job = &job;
+        for (int i = 0; i < render_context.num_threads; i++) {
+            xTaskNotifyGive(render_context.feed_tasks[i]);
+        }
+        for (int i = 0; i < render_context.num_threads; i++) {
+            xSemaphoreTake(render_context.feed_done_smphr[i], portMAX_DELAY);
+        }
+        render_context.diff_job = NULL;
+        xSemaphoreGive(render_mutex);
+
+        for (int i = 1; i < render_context.num_threads; i++) {
+            for (int x = 0; x < fb_width / 2; x++) {
+                col_dirtyness[x] |= job.col_dirtyness[i][x];
+            }
+        }
+    } else {
+        // Without an output buffer, interlace into an internal scratch line
+        // to only calculate the dirtyness.
+        if (interlaced == NULL) {
+            job.scratch_lines[0]
+                = heap_caps_aligned_alloc(16, fb_width, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+            assert(job.scratch_lines[0] != NULL);
+        }
+        difference_lines(&job, 0, 1);
+        heap_caps_free(job.scratch_lines[0]);
+    }
+
+    // Changes outside of the crop on the same lines are neither drawn nor copied back.
+    for (int x = 0; x < fb_width; x++) {
+        if (x < crop_to.x || x >= x_end) {
+            col_dirtyness[x / 2] &= x % 2 ? 0x0F : 0xF0;
+        }
     }
 
     int min_x, min_y, max_x, max_y;
@@ -470,7 +972,7 @@ EpdRect epd_difference_image_base(
             break;
     }
     for (max_x = x_end - 1; max_x >= crop_to.x; max_x--) {
-        uint8_t mask = min_x % 2 ? 0xF0 : 0x0F;
+        uint8_t mask = max_x % 2 ? 0xF0 : 0x0F;
         if ((col_dirtyness[max_x / 2] & mask) != 0)
             break;
     }
@@ -490,9 +992,287 @@ EpdRect epd_difference_image_base(
         .height = max(max_y - min_y + 1, 0),
     };
 
+    add_diff_time(start_us);
     return crop_rect;
 }
 
+EpdRect epd_difference_image_base(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    int fb_width,
+    int fb_height,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness
+) {
+    return difference_image(
+        to, from, crop_to, fb_width, fb_height, NULL, interlaced, dirty_lines, col_dirtyness
+    );
+}
+
+EpdRect epd_difference_image_tiles(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    const uint8_t* dirty_tiles,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness
+) {
+    return difference_image(
+        to, from, crop_to, epd_width(), epd_height(), dirty_tiles, NULL, dirty_lines, col_dirtyness
+    );
+}
+
+static inline int packed_bits_per_pixel(enum EpdFramebufferFormat format) {
+    return format == EPD_FB_1BPP ? 1 : 2;
+}
+
+/// Gray level of pixel `x` of a line with 2 or 1 bits per pixel.
+static inline uint8_t packed_level(const uint8_t* line, int bits, int x) {
+    int per_byte = 8 / bits;
+    uint8_t value = (line[x / per_byte] >> (bits * (x % per_byte))) & ((1 << bits) - 1);
+    return bits == 1 ? value * 0xF : gray_levels_2bpp[value];
+}
+
+EpdRect epd_difference_image_packed(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    enum EpdFramebufferFormat format,
+    uint8_t* interlaced,
+    bool* dirty_lines,
+    uint8_t* col_dirtyness,
+    EpdTransitionHistogram* transitions
+) {
+    assert(format != EPD_FB_4BPP);
+    int64_t start_us = esp_timer_get_time();
+
+    int fb_width = epd_width();
+    int bits = packed_bits_per_pixel(format);
+    int per_byte = 8 / bits;
+    int line_bytes = fb_width / per_byte;
+    memset(col_dirtyness, 0, fb_width / 2);
+    memset(dirty_lines, 0, sizeof(bool) * epd_height());
+
+    int x_start = max(crop_to.x, 0);
+    int x_end = min(crop_to.x + crop_to.width, fb_width);
+    int y_start = max(crop_to.y, 0);
+    int y_end = min(crop_to.y + crop_to.height, epd_height());
+
+    int min_x = x_end, max_x = x_start - 1;
+    int min_y = y_end, max_y = y_start - 1;
+    for (int y = y_start; y < y_end; y++) {
+        const uint8_t* to_line = to + y * line_bytes;
+        const uint8_t* from_line = from + y * line_bytes;
+        if (interlaced != NULL) {
+            uint8_t* line = interlaced + y * fb_width;
+            for (int x = 0; x < fb_width; x++) {
+                line[x] = (packed_level(to_line, bits, x) << 4) | packed_level(from_line, bits, x);
+            }
+        }
+
+        bool dirty = false;
+        for (int b = x_start / per_byte; b < (x_end + per_byte - 1) / per_byte; b++) {
+            if (to_line[b] == from_line[b]) {
+                continue;
+            }
+            int x_last = min((b + 1) * per_byte, x_end);
+            for (int x = max(b * per_byte, x_start); x < x_last; x++) {
+                uint8_t changed = packed_level(to_line, bits, x) ^ packed_level(from_line, bits, x);
+                if (changed) {
+                    col_dirtyness[x / 2] |= 0xF << (4 * (x % 2));
+                    min_x = min(min_x, x);
+                    max_x = max(max_x, x);
+                    dirty = true;
+                }
+            }
+        }
+        if (dirty) {
+            dirty_lines[y] = true;
+            min_y = min(min_y, y);
+            max_y = max(max_y, y);
+        }
+    }
+
+    EpdRect crop_rect = {
+        .x = min_x,
+        .y = min_y,
+        .width = max(max_x - min_x + 1, 0),
+        .height = max(max_y - min_y + 1, 0),
+    };
+
+    // the pixels on the dirty lines and columns, which are all driven
+    if (transitions != NULL) {
+        memset(transitions, 0, sizeof(EpdTransitionHistogram));
+        for (int y = crop_rect.y; y < crop_rect.y + crop_rect.height; y++) {
+            if (!dirty_lines[y]) {
+                continue;
+            }
+            const uint8_t* to_line = to + y * line_bytes;
+            const uint8_t* from_line = from + y * line_bytes;
+            for (int x = crop_rect.x; x < crop_rect.x + crop_rect.width; x++) {
+                if ((col_dirtyness[x / 2] >> (4 * (x % 2))) & 0xF) {
+                    uint8_t t = packed_level(to_line, bits, x);
+                    uint8_t f = packed_level(from_line, bits, x);
+                    transitions->counts[(t << 4) | f]++;
+                }
+            }
+        }
+    }
+
+    add_diff_time(start_us);
+    return crop_rect;
+}
+
+void epd_difference_copy_back_packed(
+    const uint8_t* to,
+    uint8_t* from,
+    EpdRect area,
+    enum EpdFramebufferFormat format,
+    const bool* dirty_lines
+) {
+    int bits = packed_bits_per_pixel(format);
+    int per_byte = 8 / bits;
+    int line_bytes = epd_width() / per_byte;
+    int x_start = max(area.x, 0);
+    int x_end = min(area.x + area.width, epd_width());
+    if (x_end <= x_start) {
+        return;
+    }
+
+    // partial bytes at the edges of the area
+    int first = x_start / per_byte;
+    int last = (x_end - 1) / per_byte;
+    uint8_t first_mask = 0xFF << (bits * (x_start % per_byte));
+    uint8_t last_mask = 0xFF >> (bits * ((per_byte - x_end % per_byte) % per_byte));
+    if (first == last) {
+        first_mask &= last_mask;
+    }
+
+    for (int y = max(area.y, 0); y < min(area.y + area.height, epd_height()); y++) {
+        if (!dirty_lines[y]) {
+            continue;
+        }
+        const uint8_t* to_line = to + y * line_bytes;
+        uint8_t* from_line = from + y * line_bytes;
+        from_line[first] = (from_line[first] & ~first_mask) | (to_line[first] & first_mask);
+        if (last > first) {
+            memcpy(from_line + first + 1, to_line + first + 1, last - first - 1);
+            from_line[last] = (from_line[last] & ~last_mask) | (to_line[last] & last_mask);
+        }
+    }
+}
+
+/// Maximum number of separate column spans copied back per line.
+#define COPY_BACK_MAX_SPANS 16
+/// Spans separated by fewer unchanged bytes than this are copied as one.
+#define COPY_BACK_MIN_GAP 16
+
+/// Copy the pixels `x` to `x_last` of a line, including partial bytes at the edges.
+static void copy_line_span(const uint8_t* lfb, uint8_t* lbb, int x, int x_last) {
+    if (x % 2) {
+        *(lbb + x / 2) = (*(lfb + x / 2) & 0xF0) | (*(lbb + x / 2) & 0x0F);
+        x += 1;
+    }
+
+    if (!(x_last % 2)) {
+        *(lbb + x_last / 2) = (*(lfb + x_last / 2) & 0x0F) | (*(lbb + x_last / 2) & 0xF0);
+        x_last -= 1;
+    }
+
+    if (x_last >= x) {
+        memcpy(lbb + (x / 2), lfb + (x / 2), (x_last - x + 1) / 2);
+    }
+}
+
+void epd_difference_copy_back(
+    const uint8_t* to,
+    uint8_t* from,
+    EpdRect area,
+    const bool* dirty_lines,
+    const uint8_t* col_dirtyness
+) {
+    int buf_width = epd_width();
+    int x_end = min(area.x + area.width, buf_width);
+    if (x_end <= area.x) {
+        return;
+    }
+
+    // Columns that are not dirty are equal on all lines, so only the
+    // spans of dirty column bytes need to be copied.
+    int span_start[COPY_BACK_MAX_SPANS];
+    int span_last[COPY_BACK_MAX_SPANS];
+    int num_spans = 0;
+    for (int b = area.x / 2; b <= (x_end - 1) / 2; b++) {
+        if (col_dirtyness[b] == 0) {
+            continue;
+        }
+        int x = max(2 * b, area.x);
+        int x_last = min(2 * b + 1, x_end - 1);
+        if (num_spans > 0
+            && (num_spans == COPY_BACK_MAX_SPANS
+                || x - span_last[num_spans - 1] <= 2 * COPY_BACK_MIN_GAP)) {
+            span_last[num_spans - 1] = x_last;
+        } else {
+            span_start[num_spans] = x;
+            span_last[num_spans] = x_last;
+            num_spans++;
+        }
+    }
+
+    for (int l = area.y; l < area.y + area.height; l++) {
+        if (dirty_lines[l] > 0) {
+            const uint8_t* lfb = to + buf_width / 2 * l;
+            uint8_t* lbb = from + buf_width / 2 * l;
+            for (int i = 0; i < num_spans; i++) {
+                copy_line_span(lfb, lbb, span_start[i], span_last[i]);
+            }
+        }
+    }
+}
+
+void epd_difference_transitions(
+    const uint8_t* to,
+    const uint8_t* from,
+    EpdRect crop_to,
+    const bool* dirty_lines,
+    const uint8_t* col_dirtyness,
+    EpdTransitionHistogram* histogram
+) {
+    int64_t start_us = esp_timer_get_time();
+    memset(histogram, 0, sizeof(EpdTransitionHistogram));
+
+    int fb_width = epd_width();
+    int x_start = max(crop_to.x, 0);
+    int x_end = min(crop_to.x + crop_to.width, fb_width);
+    int y_start = max(crop_to.y, 0);
+    int y_end = min(crop_to.y + crop_to.height, epd_height());
+
+    for (int y = y_start; y < y_end; y++) {
+        if (!dirty_lines[y]) {
+            continue;
+        }
+        const uint8_t* to_line = to + y * fb_width / 2;
+        const uint8_t* from_line = from + y * fb_width / 2;
+        for (int i = x_start / 2; i < (x_end + 1) / 2; i++) {
+            uint8_t dirty = col_dirtyness[i];
+            if (dirty == 0) {
+                continue;
+            }
+            uint8_t t = to_line[i];
+            uint8_t f = from_line[i];
+            if ((dirty & 0x0F) && 2 * i >= x_start) {
+                histogram->counts[((t & 0x0F) << 4) | (f & 0x0F)]++;
+            }
+            if ((dirty & 0xF0) && 2 * i + 1 < x_end) {
+                histogram->counts[(t & 0xF0) | (f >> 4)]++;
+            }
+        }
+    }
+    add_diff_time(start_us);
+}
+
 EpdRect epd_difference_image(
     const uint8_t* to,
     const uint8_t* from,
@@ -525,3 +1305,299 @@ EpdRect epd_difference_image_cropped(
     );
     return result;
 }
+
+#ifdef RENDER_METHOD_LCD
+
+/// Size of the lookup table of each update region, only the 1k difference LUT is supported.
+#define REGION_LUT_SIZE (1 << 10)
+
+static bool areas_overlap(EpdRect a, EpdRect b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height
+           && b.y < a.y + a.height;
+}
+
+/**
+ * Advance the update regions to the next frame.
+ * Regions whose last frame was drawn are completed and `from` is updated in their area,
+ * pending regions join, and the lookup tables of all active regions are built.
+ * Returns false once no region is left to draw.
+ */
+static bool next_region_frame(RenderContext_t* ctx) {
+    int width = ctx->display_width;
+    int top = ctx->display_height;
+    int bottom = 0;
+
+    xSemaphoreTake(region_mutex, portMAX_DELAY);
+    for (int r = 0; r < EPD_MAX_UPDATE_REGIONS; r++) {
+        UpdateRegion_t* region = &ctx->regions[r];
+        if (ctx->regions_drawn & (1 << r)) {
+            region->error |= ctx->error;
+            region->current_frame++;
+            // the render threads are done reading the previous image
+            if (region->current_frame >= region->cycle_frames) {
+                EpdRect area = region->area;
+                for (int l = area.y; l < area.y + area.height; l++) {
+                    const uint8_t* lfb = region_to + width / 2 * l;
+                    uint8_t* lbb = region_from + width / 2 * l;
+                    copy_line_span(lfb, lbb, area.x, area.x + area.width - 1);
+                }
+                region->state = REGION_DONE;
+                xSemaphoreGive(region->done);
+            }
+        }
+        if (region->state == REGION_PENDING) {
+            region->state = REGION_ACTIVE;
+        }
+    }
+
+    ctx->regions_drawn = 0;
+    for (int r = 0; r < EPD_MAX_UPDATE_REGIONS; r++) {
+        UpdateRegion_t* region = &ctx->regions[r];
+        if (region->state == REGION_ACTIVE) {
+            ctx->regions_drawn |= 1 << r;
+            top = min(top, region->area.y);
+            bottom = max(bottom, region->area.y + region->area.height);
+        }
+    }
+    ctx->data_ptr = region_to;
+    ctx->diff_from_ptr = region_from;
+    xSemaphoreGive(region_mutex);
+
+    ctx->error = EPD_DRAW_SUCCESS;
+    if (ctx->regions_drawn == 0) {
+        return false;
+    }
+
+    for (int r = 0; r < EPD_MAX_UPDATE_REGIONS; r++) {
+        UpdateRegion_t* region = &ctx->regions[r];
+        if (ctx->regions_drawn & (1 << r)) {
+            build_waveform_lut(
+                region->lut,
+                region->phases,
+                region->lut_build_func,
+                REGION_LUT_SIZE,
+                region->current_frame
+            );
+        }
+    }
+
+    // only the band of lines covered by regions is driven
+    EpdRect band = {
+        .x = 0,
+        .y = top,
+        .width = width,
+        .height = bottom - top,
+    };
+    ctx->crop_to = band;
+    ctx->lines_total = drawn_lines_total(ctx->area, band, true);
+    ctx->lines_skipped = skipped_lines_total(ctx->area, band, true, NULL, ctx->lines_total);
+    ctx->lines_prepared = ctx->lines_skipped;
+    ctx->lines_consumed = ctx->lines_skipped;
+    return true;
+}
+
+/**
+ * Draw frames as long as update regions are active.
+ * Plain updates are held off meanwhile by the render mutex.
+ */
+static void region_task_main(void* arg) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xSemaphoreTake(render_mutex, portMAX_DELAY);
+
+        LutFunctionPair lut_functions = find_lut_functions(
+            MODE_PACKING_1PPB_DIFFERENCE, render_context.conversion_lut_size
+        );
+        render_context.area = epd_full_screen();
+        render_context.drawn_lines = NULL;
+        render_context.copy_back_ptr = NULL;
+        render_context.mode = MODE_PACKING_1PPB_DIFFERENCE;
+        render_context.lut_lookup_func = lut_functions.lookup_func;
+        render_context.regions_drawn = 0;
+
+        lcd_do_region_update(&render_context, next_region_frame);
+
+        render_context.regions_drawn = 0;
+        xSemaphoreGive(render_mutex);
+    }
+}
+
+/// Allocate the buffers of the update regions and start the region task.
+static void init_regions() {
+    int mask_len = render_context.display_width / 4;
+    for (int r = 0; r < EPD_MAX_UPDATE_REGIONS; r++) {
+        UpdateRegion_t* region = &render_context.regions[r];
+        region->lut = heap_caps_malloc(REGION_LUT_SIZE, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+        assert(region->lut != NULL);
+        region->line_mask
+            = heap_caps_aligned_alloc(16, mask_len, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+        assert(region->line_mask != NULL);
+        region->done = xSemaphoreCreateBinary();
+        region->state = REGION_FREE;
+    }
+    for (int i = 0; i < render_context.num_threads; i++) {
+        render_context.region_line_buffers[i]
+            = heap_caps_aligned_alloc(16, mask_len, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+        assert(render_context.region_line_buffers[i] != NULL);
+    }
+    RTOS_ERROR_CHECK(xTaskCreate(
+        region_task_main,
+        "epd_regions",
+        1 << 12,
+        NULL,
+        render_thread_config.priority,
+        &region_task
+    ));
+}
+
+static void deinit_regions() {
+    if (region_task == NULL) {
+        return;
+    }
+    vTaskDelete(region_task);
+    region_task = NULL;
+    for (int r = 0; r < EPD_MAX_UPDATE_REGIONS; r++) {
+        UpdateRegion_t* region = &render_context.regions[r];
+        heap_caps_free(region->lut);
+        heap_caps_free(region->line_mask);
+        vSemaphoreDelete(region->done);
+        memset(region, 0, sizeof(UpdateRegion_t));
+    }
+    for (int i = 0; i < render_context.num_threads; i++) {
+        heap_caps_free(render_context.region_line_buffers[i]);
+        render_context.region_line_buffers[i] = NULL;
+    }
+}
+
+#endif
+
+enum EpdDrawError epd_region_start(
+    EpdRect area,
+    const uint8_t* to,
+    uint8_t* from,
+    enum EpdDrawMode mode,
+    int temperature,
+    const EpdWaveform* waveform,
+    int* region
+) {
+#ifdef RENDER_METHOD_LCD
+    assert((uint32_t)to % 16 == 0);
+    assert((uint32_t)from % 16 == 0);
+
+    if (waveform == NULL) {
+        return EPD_DRAW_NO_PHASES_AVAILABLE;
+    }
+    int waveform_range = waveform_temp_range_index(waveform, temperature);
+    if (waveform_range < 0) {
+        return EPD_DRAW_NO_PHASES_AVAILABLE;
+    }
+    if (mode & MODE_EPDIY_MONOCHROME) {
+        return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
+    }
+    int waveform_index = get_waveform_index(waveform, mode);
+    if (waveform_index < 0) {
+        return EPD_DRAW_MODE_NOT_FOUND;
+    }
+    const EpdWaveformPhases* phases
+        = waveform->mode_data[waveform_index]->range_data[waveform_range];
+
+    LutFunctionPair lut_functions = find_lut_functions(
+        MODE_PACKING_1PPB_DIFFERENCE | mode, render_context.conversion_lut_size
+    );
+    if (lut_functions.build_func == NULL || lut_functions.build_size != REGION_LUT_SIZE) {
+        return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
+    }
+
+    int x_start = max(area.x, 0);
+    int x_end = min(area.x + area.width, epd_width());
+    int y_start = max(area.y, 0);
+    int y_end = min(area.y + area.height, epd_height());
+    if (x_end <= x_start || y_end <= y_start) {
+        return EPD_DRAW_INVALID_CROP;
+    }
+    EpdRect clipped = {
+        .x = x_start,
+        .y = y_start,
+        .width = x_end - x_start,
+        .height = y_end - y_start,
+    };
+
+    xSemaphoreTake(region_mutex, portMAX_DELAY);
+    if (region_task == NULL) {
+        init_regions();
+    }
+
+    int free_region = -1;
+    bool active = false;
+    for (int r = 0; r < EPD_MAX_UPDATE_REGIONS; r++) {
+        UpdateRegion_t* other = &render_context.regions[r];
+        if (other->state == REGION_PENDING || other->state == REGION_ACTIVE) {
+            if (areas_overlap(clipped, other->area) || to != region_to || from != region_from) {
+                xSemaphoreGive(region_mutex);
+                return EPD_DRAW_REGION_UNAVAILABLE;
+            }
+            active = true;
+        } else if (other->state == REGION_FREE && free_region < 0) {
+            free_region = r;
+        }
+    }
+    if (free_region < 0) {
+        xSemaphoreGive(region_mutex);
+        return EPD_DRAW_REGION_UNAVAILABLE;
+    }
+    if (!active) {
+        region_to = to;
+        region_from = from;
+    }
+
+    UpdateRegion_t* started = &render_context.regions[free_region];
+    started->area = clipped;
+    started->phases = phases;
+    started->lut_build_func = lut_functions.build_func;
+    started->current_frame = 0;
+    started->cycle_frames = phases->phases;
+    started->error = EPD_DRAW_SUCCESS;
+
+    // two mask bits per pixel, the first pixel in the lowest bits
+    memset(started->line_mask, 0, render_context.display_width / 4);
+    for (int x = x_start; x < x_end; x++) {
+        started->line_mask[x / 4] |= 0x3 << (2 * (x % 4));
+    }
+
+    xSemaphoreTake(started->done, 0);
+    started->state = REGION_PENDING;
+    xSemaphoreGive(region_mutex);
+
+    xTaskNotifyGive(region_task);
+    *region = free_region;
+    return EPD_DRAW_SUCCESS;
+#else
+    return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
+#endif
+}
+
+bool epd_region_done(int region) {
+    assert(region >= 0 && region < EPD_MAX_UPDATE_REGIONS);
+    return render_context.regions[region].state == REGION_DONE;
+}
+
+enum EpdDrawError epd_region_wait(int region) {
+    assert(region >= 0 && region < EPD_MAX_UPDATE_REGIONS);
+#ifdef RENDER_METHOD_LCD
+    UpdateRegion_t* waited = &render_context.regions[region];
+    assert(waited->state != REGION_FREE);
+
+    xSemaphoreTake(waited->done, portMAX_DELAY);
+    xSemaphoreTake(region_mutex, portMAX_DELAY);
+    enum EpdDrawError err = waited->error;
+    waited->state = REGION_FREE;
+    xSemaphoreGive(region_mutex);
+
+    if (err & EPD_DRAW_EMPTY_LINE_QUEUE) {
+        ESP_LOGE("epdiy", "line buffer underrun occurred!");
+    }
+    return err;
+#else
+    return EPD_DRAW_LOOKUP_NOT_IMPLEMENTED;
+#endif
+}
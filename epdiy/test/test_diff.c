@@ -181,4 +181,53 @@ TEST_CASE("different 4-byte alignments work", "[epdiy,unit]") {
     }
 
     diff_test_buffers_free(&bufs);
-}
\ No newline at end of file
+}
+TEST_CASE("narrow unaligned spans work", "[epdiy,unit]") {
+    const int example_len = 64;
+    DiffTestBuffers bufs;
+
+    diff_test_buffers_init(&bufs, example_len);
+
+    // spans too short to contain a full 16 byte block, at all 2-byte offsets
+    for (int start_offset = 0; start_offset < 32; start_offset += 2) {
+        for (int len = 1; len <= 24; len++) {
+            diff_test_buffers_fill(&bufs, example_len);
+
+            bool expected_dirty = false;
+            for (int i = start_offset; i < start_offset + len; i++) {
+                expected_dirty |= bufs.expected_col_dirtyness[i] != 0;
+            }
+            // outside of the span the buffers should stay clear
+            memset(bufs.expected_col_dirtyness, 0, start_offset);
+            memset(bufs.expected_interlaced, 0, 2 * start_offset);
+            memset(
+                bufs.expected_col_dirtyness + start_offset + len,
+                0,
+                example_len - start_offset - len
+            );
+            memset(
+                bufs.expected_interlaced + 2 * (start_offset + len),
+                0,
+                2 * (example_len - start_offset - len)
+            );
+
+            bool dirty = _epd_interlace_line(
+                bufs.to + start_offset,
+                bufs.from + start_offset,
+                bufs.interlaced + 2 * start_offset,
+                bufs.col_dirtyness + start_offset,
+                2 * len
+            );
+
+            TEST_ASSERT(dirty == expected_dirty);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(
+                bufs.expected_col_dirtyness, bufs.col_dirtyness, example_len
+            );
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(
+                bufs.expected_interlaced, bufs.interlaced, 2 * example_len
+            );
+        }
+    }
+
+    diff_test_buffers_free(&bufs);
+}
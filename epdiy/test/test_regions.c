@@ -0,0 +1,77 @@
+#include <esp_heap_caps.h>
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+#include "epd_board.h"
+#include "epd_display.h"
+#include "epdiy.h"
+
+// choose the default demo board depending on the architecture
+#ifdef CONFIG_IDF_TARGET_ESP32
+#define TEST_BOARD epd_board_v6
+#elif defined(CONFIG_IDF_TARGET_ESP32S3)
+#define TEST_BOARD epd_board_v7
+#endif
+
+static void assert_area_copied_back(const uint8_t* to, const uint8_t* from, EpdRect area) {
+    int width = epd_width();
+    for (int y = area.y; y < area.y + area.height; y++) {
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(
+            to + y * width / 2 + area.x / 2, from + y * width / 2 + area.x / 2, area.width / 2
+        );
+    }
+}
+
+TEST_CASE("fast region completes while a slow region is drawn", "[epdiy,e2e]") {
+    epd_init(&TEST_BOARD, &ED097TC2, EPD_LUT_1K);
+
+    EpdRect screen = epd_full_screen();
+    size_t fb_size = screen.width / 2 * screen.height;
+    uint8_t* to = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_SPIRAM);
+    uint8_t* from = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_SPIRAM);
+    TEST_ASSERT_NOT_NULL(to);
+    TEST_ASSERT_NOT_NULL(from);
+    memset(from, 0xFF, fb_size);
+    memset(to, 0xFF, fb_size);
+
+    EpdRect image = { .x = 0, .y = 0, .width = screen.width / 2, .height = screen.height };
+    EpdRect clock = { .x = screen.width / 2 + 64, .y = 64, .width = 256, .height = 128 };
+    for (int y = image.y; y < image.y + image.height; y++) {
+        for (int x = image.x; x < image.x + image.width; x += 2) {
+            uint8_t color = x * 16 / image.width;
+            to[y * screen.width / 2 + x / 2] = color | (color << 4);
+        }
+    }
+    for (int y = clock.y; y < clock.y + clock.height; y++) {
+        memset(to + y * screen.width / 2 + clock.x / 2, 0x00, clock.width / 2);
+    }
+
+    const EpdWaveform* waveform = epd_get_display()->default_waveform;
+    int image_region, clock_region;
+    epd_poweron();
+    TEST_ASSERT_EQUAL(
+        EPD_DRAW_SUCCESS,
+        epd_region_start(image, to, from, MODE_GC16, 25, waveform, &image_region)
+    );
+    TEST_ASSERT_EQUAL(
+        EPD_DRAW_REGION_UNAVAILABLE,
+        epd_region_start(image, to, from, MODE_DU, 25, waveform, &clock_region)
+    );
+    TEST_ASSERT_EQUAL(
+        EPD_DRAW_SUCCESS,
+        epd_region_start(clock, to, from, MODE_DU, 25, waveform, &clock_region)
+    );
+
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, epd_region_wait(clock_region));
+    TEST_ASSERT_FALSE(epd_region_done(image_region));
+    assert_area_copied_back(to, from, clock);
+
+    TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, epd_region_wait(image_region));
+    assert_area_copied_back(to, from, image);
+    epd_poweroff();
+
+    heap_caps_free(to);
+    heap_caps_free(from);
+    epd_deinit();
+}
@@ -0,0 +1,110 @@
+#include <esp_heap_caps.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "epd_board.h"
+#include "epd_display.h"
+#include "epdiy.h"
+
+// choose the default demo board depending on the architecture
+#ifdef CONFIG_IDF_TARGET_ESP32
+#define TEST_BOARD epd_board_v6
+#elif defined(CONFIG_IDF_TARGET_ESP32S3)
+#define TEST_BOARD epd_board_v7
+#endif
+
+#define PROBE_PRIORITY 5
+
+typedef struct {
+    const char* name;
+    EpdRenderThreadConfig config;
+} ThreadBenchConfig;
+
+static const ThreadBenchConfig bench_configs[] = {
+    { "2 threads, max. priority", { 2, configMAX_PRIORITIES - 1, { 0, 1 } } },
+    { "2 threads, priority 10", { 2, 10, { 0, 1 } } },
+    { "1 thread on core 1, max. priority", { 1, configMAX_PRIORITIES - 1, { 1, 0 } } },
+    { "1 thread on core 1, priority 10", { 1, 10, { 1, 0 } } },
+};
+
+/// Largest delay of a lower priority task on core 0 while the update runs.
+static volatile int64_t probe_max_delay_us;
+static volatile bool probe_running;
+
+/**
+ * Wake up every tick and record the largest delay between wake ups,
+ * as a measure of how long other tasks on core 0 are starved.
+ */
+static void latency_probe(void* arg) {
+    int64_t last = esp_timer_get_time();
+    while (probe_running) {
+        vTaskDelay(1);
+        int64_t now = esp_timer_get_time();
+        if (now - last > probe_max_delay_us) {
+            probe_max_delay_us = now - last;
+        }
+        last = now;
+    }
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("render thread configurations", "[epdiy,e2e,perf]") {
+    EpdRenderThreadConfig default_config = epd_get_render_thread_config();
+
+    for (int c = 0; c < sizeof(bench_configs) / sizeof(ThreadBenchConfig); c++) {
+        const ThreadBenchConfig* bench = &bench_configs[c];
+        epd_set_render_thread_config(&bench->config);
+        epd_init(&TEST_BOARD, &ED097TC2, EPD_LUT_1K);
+
+        // a horizontal gray gradient over the whole screen
+        EpdRect area = epd_full_screen();
+        uint8_t* fb = heap_caps_malloc(area.width / 2 * area.height, MALLOC_CAP_SPIRAM);
+        TEST_ASSERT_NOT_NULL(fb);
+        for (int y = 0; y < area.height; y++) {
+            for (int x = 0; x < area.width / 2; x++) {
+                uint8_t color = x * 32 / area.width;
+                fb[y * area.width / 2 + x] = color | (color << 4);
+            }
+        }
+
+        probe_max_delay_us = 0;
+        probe_running = true;
+        xTaskCreatePinnedToCore(latency_probe, "probe", 1 << 11, NULL, PROBE_PRIORITY, NULL, 0);
+
+        epd_poweron();
+        int64_t start = esp_timer_get_time();
+        enum EpdDrawError err = epd_draw_base(
+            area,
+            fb,
+            area,
+            MODE_GL16 | MODE_PACKING_2PPB | PREVIOUSLY_WHITE,
+            25,
+            NULL,
+            NULL,
+            epd_get_display()->default_waveform
+        );
+        int64_t end = esp_timer_get_time();
+        epd_poweroff();
+
+        probe_running = false;
+        vTaskDelay(2);
+
+        printf(
+            "%s: update took %lldms, core 0 task delayed by up to %lldms\n",
+            bench->name,
+            (end - start) / 1000,
+            probe_max_delay_us / 1000
+        );
+        TEST_ASSERT_EQUAL(EPD_DRAW_SUCCESS, err);
+
+        heap_caps_free(fb);
+        epd_deinit();
+    }
+
+    epd_set_render_thread_config(&default_config);
+}
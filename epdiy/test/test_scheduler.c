@@ -0,0 +1,64 @@
+#include <unity.h>
+
+#include "epd_highlevel.h"
+
+static const EpdRect clock_area = { .x = 10, .y = 10, .width = 100, .height = 40 };
+static const EpdRect battery_area = { .x = 120, .y = 10, .width = 40, .height = 40 };
+static const EpdRect list_area = { .x = 10, .y = 300, .width = 400, .height = 200 };
+
+TEST_CASE("nearby areas with the same mode are merged", "[epdiy,unit]") {
+    EpdRefreshScheduler sched = epd_hl_scheduler_init(16, 0);
+
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, clock_area, MODE_DU));
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, battery_area, MODE_DU));
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, list_area, MODE_DU));
+
+    TEST_ASSERT_EQUAL_INT(2, sched.num_pending);
+    TEST_ASSERT_EQUAL_INT(10, sched.pending[0].area.x);
+    TEST_ASSERT_EQUAL_INT(150, sched.pending[0].area.width);
+    TEST_ASSERT_EQUAL_INT(40, sched.pending[0].area.height);
+}
+
+TEST_CASE("areas with different modes are kept in order", "[epdiy,unit]") {
+    EpdRefreshScheduler sched = epd_hl_scheduler_init(16, 0);
+
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, clock_area, MODE_GC16));
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, clock_area, MODE_DU));
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, battery_area, MODE_GC16));
+
+    TEST_ASSERT_EQUAL_INT(2, sched.num_pending);
+    TEST_ASSERT_EQUAL_INT(MODE_GC16, sched.pending[0].mode);
+    TEST_ASSERT_EQUAL_INT(150, sched.pending[0].area.width);
+    TEST_ASSERT_EQUAL_INT(MODE_DU, sched.pending[1].mode);
+}
+
+TEST_CASE("grown area absorbs later pending areas", "[epdiy,unit]") {
+    EpdRefreshScheduler sched = epd_hl_scheduler_init(0, 0);
+    EpdRect left = { .x = 0, .y = 0, .width = 10, .height = 10 };
+    EpdRect right = { .x = 20, .y = 0, .width = 10, .height = 10 };
+    EpdRect bridge = { .x = 5, .y = 0, .width = 20, .height = 10 };
+
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, left, MODE_GL16));
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, right, MODE_GL16));
+    TEST_ASSERT_EQUAL_INT(2, sched.num_pending);
+
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, bridge, MODE_GL16));
+    TEST_ASSERT_EQUAL_INT(1, sched.num_pending);
+    TEST_ASSERT_EQUAL_INT(0, sched.pending[0].area.x);
+    TEST_ASSERT_EQUAL_INT(30, sched.pending[0].area.width);
+}
+
+TEST_CASE("full scheduler rejects new areas", "[epdiy,unit]") {
+    EpdRefreshScheduler sched = epd_hl_scheduler_init(0, 0);
+    for (int i = 0; i < EPD_HL_MAX_PENDING_AREAS; i++) {
+        EpdRect area = { .x = 0, .y = i * 20, .width = 10, .height = 10 };
+        TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, area, MODE_DU));
+    }
+    EpdRect extra = { .x = 0, .y = 500, .width = 10, .height = 10 };
+    TEST_ASSERT_FALSE(epd_hl_invalidate(&sched, extra, MODE_DU));
+
+    EpdRefreshScheduler taken = epd_hl_scheduler_take(&sched);
+    TEST_ASSERT_EQUAL_INT(0, sched.num_pending);
+    TEST_ASSERT_EQUAL_INT(EPD_HL_MAX_PENDING_AREAS, taken.num_pending);
+    TEST_ASSERT_TRUE(epd_hl_invalidate(&sched, extra, MODE_DU));
+}
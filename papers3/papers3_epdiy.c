@@ -21,6 +21,7 @@
 // FreeRTOS 基础头文件
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 // GPIO 驱动
 #include "driver/gpio.h"
@@ -108,10 +109,57 @@ inline static void fast_gpio_set_lo(gpio_num_t gpio_num) {
     gpio_set_level(gpio_num, 0);
 }
 
-// 精确延时（参考demo工程）
-void IRAM_ATTR busy_delay(uint32_t cycles) {
-    volatile uint64_t counts = esp_timer_get_time() + cycles;
-    while (esp_timer_get_time() < counts) ;
+// ===== 电源管理 =====
+// EPD_EN/BST_EN电源轨在刷新之间保持开启，空闲超时或power_off()后才关闭，
+// 连续刷新时不必每次等待电源轨稳定
+
+#define POWER_RAIL_SETTLE_MS  24    // 电源轨开启后的稳定时间
+#define POWER_IDLE_TIMEOUT_MS 2000  // 最后一次刷新后保持电源轨的时间
+
+static bool power_rails_on = false;
+static bool power_panel_on = false;  // poweron()和poweroff()之间
+static bool power_hold = false;      // power_on()开启的电源会话
+static int power_idle_timeout_ms = POWER_IDLE_TIMEOUT_MS;
+static SemaphoreHandle_t power_lock = NULL;
+static esp_timer_handle_t power_idle_timer = NULL;
+
+// 让出CPU的等待，至少等待ms毫秒
+static void power_wait_ms(uint32_t ms) {
+    vTaskDelay((ms * configTICK_RATE_HZ + 999) / 1000 + 1);
+}
+
+// 开启电源轨 (需持有power_lock)
+static void papers3_power_rails_on(void) {
+    if (power_rails_on) {
+        return;
+    }
+    fast_gpio_set_hi(EPD_EN);   // EPD_EN
+    power_wait_ms(POWER_RAIL_SETTLE_MS);
+    fast_gpio_set_hi(BST_EN);   // BST_EN
+    power_wait_ms(POWER_RAIL_SETTLE_MS);
+    power_rails_on = true;
+}
+
+// 关闭电源轨 (需持有power_lock)
+static void papers3_power_rails_off(void) {
+    if (!power_rails_on) {
+        return;
+    }
+    ESP_LOGI(TAG, "Papers3 power rails off");
+    fast_gpio_set_lo(BST_EN);   // BST_EN
+    power_wait_ms(3);
+    fast_gpio_set_lo(EPD_EN);   // EPD_EN
+    power_rails_on = false;
+}
+
+// 空闲超时：刷新进行中时不关闭，poweroff()会重新启动定时器
+static void papers3_power_idle_cb(void* arg) {
+    if (xSemaphoreTake(power_lock, 0) == pdTRUE) {
+        if (!power_hold && !power_panel_on) {
+            papers3_power_rails_off();
+        }
+        xSemaphoreGive(power_lock);
+    }
 }
 
 // 初始化函数（参考gtxyj.c的epd_board_init）
@@ -132,6 +180,16 @@ static void papers3_board_init(uint32_t epd_row_width) {
     fast_gpio_set_hi(EPD_SPV);   // EPD_SPV
     fast_gpio_set_lo(EPD_EN);    // EPD_EN
     fast_gpio_set_lo(BST_EN);    // BST_EN
+    power_rails_on = false;
+    power_panel_on = false;
+    
+    power_lock = xSemaphoreCreateMutex();
+    assert(power_lock != NULL);
+    const esp_timer_create_args_t timer_args = {
+        .callback = papers3_power_idle_cb,
+        .name = "epd_power_idle",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &power_idle_timer));
     
     // 关键！LCD初始化（参考gtxyj.c和v7.c）
     const EpdDisplay_t* display = epd_get_display();
@@ -154,6 +212,14 @@ static void papers3_board_deinit(void) {
     // 关键！LCD清理（参考v7.c）
     epd_lcd_deinit();
     
+    esp_timer_stop(power_idle_timer);
+    esp_timer_delete(power_idle_timer);
+    power_idle_timer = NULL;
+    vSemaphoreDelete(power_lock);
+    power_lock = NULL;
+    power_rails_on = false;
+    power_hold = false;
+    
     // GPIO状态复位（参考gtxyj.c）
     fast_gpio_set_lo(EPD_XLE);  // EPD_XLE
     fast_gpio_set_lo(EPD_SPV);  // EPD_SPV
@@ -190,13 +256,15 @@ static void papers3_board_set_ctrl(epd_ctrl_state_t* state, const epd_ctrl_state
 }
 
 // 电源开启（参考gtxyj.c的epd_board_poweron）
+// 电源轨已开启时无需等待稳定
 static void papers3_board_poweron(epd_ctrl_state_t* state) {
     ESP_LOGI(TAG, "Papers3 board power on");
     
-    fast_gpio_set_hi(EPD_EN);   // EPD_EN
-    busy_delay(100 * 240);      // 等待稳定
-    fast_gpio_set_hi(BST_EN);   // BST_EN
-    busy_delay(100 * 240);      // 等待稳定
+    xSemaphoreTake(power_lock, portMAX_DELAY);
+    esp_timer_stop(power_idle_timer);
+    power_panel_on = true;
+    
+    papers3_power_rails_on();
     fast_gpio_set_hi(EPD_SPV);  // EPD_SPV
     fast_gpio_set_hi(STH);      // STH
 }
@@ -211,12 +279,18 @@ static void papers3_board_measure_vcom(epd_ctrl_state_t* state) {
 static void papers3_board_poweroff(epd_ctrl_state_t* state) {
     ESP_LOGI(TAG, "Papers3 board power off");
     
-    // 参考gtxyj.c的注释，某些引脚可能不需要关闭
-    // fast_gpio_set_lo(BST_EN); // BST_EN
-    // busy_delay(10 * 240);
-    // fast_gpio_set_lo(EPD_EN);  // EPD_EN
-    // busy_delay(100 * 240);
+    // 电源轨由空闲定时器或power_off()关闭
     fast_gpio_set_lo(EPD_SPV);  // EPD_SPV - 这是gtxyj.c实际做的
+    
+    // epd_deinit()会在没有poweron()的情况下调用poweroff()
+    if (!power_panel_on) {
+        return;
+    }
+    power_panel_on = false;
+    if (!power_hold && power_idle_timeout_ms >= 0) {
+        esp_timer_start_once(power_idle_timer, (uint64_t)power_idle_timeout_ms * 1000);
+    }
+    xSemaphoreGive(power_lock);
 }
 
 // 设置VCOM电压（参考demo工程set_vcom）
@@ -276,6 +350,168 @@ typedef struct _papers3_epdiy_obj_t {
 // 前置声明
 extern const mp_obj_type_t papers3_epdiy_type;
 
+// ===== 异步刷新 =====
+// 刷新在独立的FreeRTOS任务中进行，使用前缓冲区的快照，
+// 面板驱动期间Python可以继续绘制下一帧、处理触摸和网络
+
+#define ASYNC_TASK_STACK    4096
+#define ASYNC_TASK_PRIORITY 5
+
+typedef struct {
+    TaskHandle_t task;
+    EpdiyHighlevelState hl;     // 状态副本，front_fb指向快照
+    uint8_t* snapshot_fb;       // 前缓冲区快照 (PSRAM)
+    uint8_t* snapshot_tiles;    // 脏区块标记快照
+    EpdRefreshScheduler areas;  // 本次要刷新的区域
+    int temperature;
+    volatile bool busy;
+} papers3_epdiy_async_t;
+
+// 只有一个显示屏，异步状态不放在GC管理的对象中
+static papers3_epdiy_async_t async_update = { 0 };
+
+// 手写墨迹会话
+#define INK_DEFAULT_WIDTH 3
+static EpdInkState ink_session;
+static bool ink_active = false;
+
+// 墨迹会话持有面板电源直到ink_end()，期间的刷新和电源操作会死锁
+static void papers3_epdiy_check_no_ink(void) {
+    if (ink_active) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("Ink session active, call ink_end() first"));
+    }
+}
+
+// ===== 刷新调度 =====
+// 收集invalidate()标记的区域，合并重叠/相邻的区域，按固定节奏批量刷新
+
+#define SCHEDULER_MERGE_DISTANCE 32   // 相距小于此像素的同模式区域合并
+#define SCHEDULER_INTERVAL_MS    250  // 两次批量刷新之间的最小间隔
+#define GHOSTING_THRESHOLD       32   // 区块快速刷新次数达到该值后在批量刷新时用GC16清除残影
+
+static EpdRefreshScheduler refresh_scheduler;
+
+// 刷新任务：等待通知，然后执行一次完整的上电→刷新→断电流程
+static void papers3_epdiy_async_task(void* arg) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        epd_poweron();
+        epd_hl_flush(&async_update.areas, &async_update.hl, async_update.temperature);
+        epd_poweroff();
+
+        async_update.busy = false;
+    }
+}
+
+// 等待正在进行的异步刷新完成 (期间处理MicroPython事件)
+static void papers3_epdiy_async_wait(void) {
+    while (async_update.busy) {
+        mp_hal_delay_ms(1);
+    }
+}
+
+// 启动异步刷新：拍摄前缓冲区快照并通知刷新任务
+static void papers3_epdiy_async_start(papers3_epdiy_obj_t *self, const EpdRefreshScheduler* areas) {
+    papers3_epdiy_check_no_ink();
+
+    // 同一时间只允许一个刷新
+    papers3_epdiy_async_wait();
+
+    int fb_size = epd_width() / 2 * epd_height();
+    if (async_update.snapshot_fb == NULL) {
+        async_update.snapshot_fb = heap_caps_aligned_alloc(16, fb_size, MALLOC_CAP_SPIRAM);
+        if (async_update.snapshot_fb == NULL) {
+            mp_raise_msg(&mp_type_MemoryError, MP_ERROR_TEXT("No memory for framebuffer snapshot"));
+        }
+    }
+    if (async_update.snapshot_tiles == NULL) {
+        async_update.snapshot_tiles = heap_caps_malloc(
+            epd_dirty_tile_count(), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (async_update.snapshot_tiles == NULL) {
+            mp_raise_msg(&mp_type_MemoryError, MP_ERROR_TEXT("No memory for framebuffer snapshot"));
+        }
+    }
+    if (async_update.task == NULL) {
+        BaseType_t ret = xTaskCreate(
+            papers3_epdiy_async_task, "epd_async", ASYNC_TASK_STACK, NULL,
+            ASYNC_TASK_PRIORITY, &async_update.task);
+        if (ret != pdPASS) {
+            async_update.task = NULL;
+            mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("Failed to create update task"));
+        }
+    }
+
+    // 横屏时只需复制刷新区域和残影清除所在的行，其他方向复制整个缓冲区
+    uint8_t* front_fb = epd_hl_get_framebuffer(&self->hl);
+    int line_bytes = epd_width() / 2;
+    int y_start = 0;
+    int y_end = epd_height();
+    if (epd_get_rotation() == EPD_ROT_LANDSCAPE) {
+        y_start = epd_height();
+        y_end = 0;
+        for (int i = 0; i < areas->num_pending; i++) {
+            const EpdRect* area = &areas->pending[i].area;
+            y_start = MIN(y_start, MAX(area->y, 0));
+            y_end = MAX(y_end, MIN(area->y + area->height, epd_height()));
+        }
+        // 刷新后epd_hl_clean_ghosting()会对达到阈值的区块整行做GC16，
+        // 每个区域最多使计数加一，可能达到阈值的区块行也需要复制
+        const int tile = EPD_HL_GHOSTING_TILE_SIZE;
+        int tile_cols = (epd_width() + tile - 1) / tile;
+        int tile_rows = (epd_height() + tile - 1) / tile;
+        int threshold = self->hl.ghosting_threshold;
+        for (int ty = 0; threshold > 0 && ty < tile_rows; ty++) {
+            for (int tx = 0; tx < tile_cols; tx++) {
+                if (self->hl.ghosting_counters[ty * tile_cols + tx] + areas->num_pending
+                    >= threshold) {
+                    y_start = MIN(y_start, ty * tile);
+                    y_end = MAX(y_end, MIN((ty + 1) * tile, epd_height()));
+                    break;
+                }
+            }
+        }
+    }
+    if (y_end > y_start) {
+        memcpy(async_update.snapshot_fb + y_start * line_bytes,
+               front_fb + y_start * line_bytes,
+               (y_end - y_start) * line_bytes);
+    }
+
+    // 刷新任务使用脏区块标记的副本；快照之后绘制的区块在共享标记中保留
+    memcpy(async_update.snapshot_tiles, self->hl.dirty_tiles, epd_dirty_tile_count());
+    for (int i = 0; i < areas->num_pending; i++) {
+        epd_hl_clear_dirty(&self->hl, areas->pending[i].area);
+    }
+
+    async_update.hl = self->hl;
+    async_update.hl.front_fb = async_update.snapshot_fb;
+    async_update.hl.dirty_tiles = async_update.snapshot_tiles;
+    async_update.areas = *areas;
+    async_update.temperature = self->temperature;
+    async_update.busy = true;
+
+    xTaskNotifyGive(async_update.task);
+}
+
+// 释放异步刷新资源
+static void papers3_epdiy_async_deinit(void) {
+    papers3_epdiy_async_wait();
+
+    if (async_update.task != NULL) {
+        vTaskDelete(async_update.task);
+        async_update.task = NULL;
+    }
+    if (async_update.snapshot_fb != NULL) {
+        heap_caps_free(async_update.snapshot_fb);
+        async_update.snapshot_fb = NULL;
+    }
+    if (async_update.snapshot_tiles != NULL) {
+        heap_caps_free(async_update.snapshot_tiles);
+        async_update.snapshot_tiles = NULL;
+    }
+}
+
 // ===== 核心功能实现 =====
 
 // 构造函数
@@ -291,15 +527,43 @@ STATIC mp_obj_t papers3_epdiy_make_new(const mp_obj_type_t *type, size_t n_args,
 }
 
 // 初始化EPD (参考ED047TC1Driver::init)
-STATIC mp_obj_t papers3_epdiy_init(mp_obj_t self_in) {
-    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+// 可选参数: LUT大小 (LUT_1K / LUT_64K), 渲染线程数 (1或2), 渲染线程优先级
+// ESP32-S3的差分刷新使用向量指令，只用到1K LUT，默认使用1K以节省63K内部RAM
+// 单个渲染线程固定在core 1，刷新时core 0留给WiFi等任务，但刷新会变慢
+STATIC mp_obj_t papers3_epdiy_init(size_t n_args, const mp_obj_t *args) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(args[0]);
     
     if (self->initialized) {
         mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy already initialized"));
     }
-    epd_init(&papers3_board, &ED047TC2, EPD_LUT_64K);  // 使用1K LUT减少内存占用
+    
+    int lut_option = (n_args > 1) ? mp_obj_get_int(args[1]) : EPD_LUT_1K;
+    if (lut_option != EPD_LUT_1K && lut_option != EPD_LUT_64K) {
+        mp_raise_ValueError(MP_ERROR_TEXT("LUT size must be LUT_1K or LUT_64K"));
+    }
+
+    EpdRenderThreadConfig thread_config = {
+        .num_threads = (n_args > 2) ? mp_obj_get_int(args[2]) : 2,
+        .priority = (n_args > 3) ? mp_obj_get_int(args[3]) : configMAX_PRIORITIES - 1,
+        .core = { 0, 1 },
+    };
+    if (thread_config.num_threads != 1 && thread_config.num_threads != 2) {
+        mp_raise_ValueError(MP_ERROR_TEXT("render threads must be 1 or 2"));
+    }
+    if (thread_config.priority < 1 || thread_config.priority >= configMAX_PRIORITIES) {
+        mp_raise_ValueError(MP_ERROR_TEXT("invalid render thread priority"));
+    }
+    if (thread_config.num_threads == 1) {
+        thread_config.core[0] = 1;
+    }
+    epd_set_render_thread_config(&thread_config);
+    epd_init(&papers3_board, &ED047TC2, (enum EpdInitOptions)lut_option);
     
     self->hl = epd_hl_init(EPD_BUILTIN_WAVEFORM);
+    refresh_scheduler = epd_hl_scheduler_init(SCHEDULER_MERGE_DISTANCE, SCHEDULER_INTERVAL_MS);
+    epd_hl_set_ghosting_threshold(&self->hl, GHOSTING_THRESHOLD);
+    // 绘图函数标记修改过的区块，刷新时只比较这些区块
+    epd_hl_set_dirty_tracking(&self->hl, true);
     
     self->initialized = true;
     ESP_LOGI(TAG, "Papers3 EPDiy initialized successfully");
@@ -312,6 +576,11 @@ STATIC mp_obj_t papers3_epdiy_deinit(mp_obj_t self_in) {
     papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
     
     if (self->initialized) {
+        if (ink_active) {
+            epd_hl_ink_end(&ink_session);
+            ink_active = false;
+        }
+        papers3_epdiy_async_deinit();
         epd_deinit();
         self->initialized = false;
         ESP_LOGI(TAG, "Papers3 EPDiy deinitialized");
@@ -333,6 +602,9 @@ STATIC mp_obj_t papers3_epdiy_get_framebuffer(mp_obj_t self_in) {
         mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("Failed to get framebuffer"));
     }
     
+    // 直接写入缓冲区的修改无法追踪，之后的刷新比较整个区域
+    epd_hl_set_dirty_tracking(&self->hl, false);
+    
     // 返回framebuffer的内存地址作为整数
     return mp_obj_new_int((mp_int_t)framebuffer);
 }
@@ -348,6 +620,11 @@ STATIC mp_obj_t papers3_epdiy_update_screen(size_t n_args, const mp_obj_t *args)
     // 默认模式：MODE_GC16 (16级灰度)
     int mode = (n_args > 1) ? mp_obj_get_int(args[1]) : MODE_GC16;
     
+    papers3_epdiy_check_no_ink();
+
+    // 等待异步刷新完成
+    papers3_epdiy_async_wait();
+
     // 电源管理 + 更新 (参考demo工程)
     epd_poweron();
     epd_hl_update_screen(&self->hl, (enum EpdDrawMode)mode, self->temperature);
@@ -381,6 +658,11 @@ STATIC mp_obj_t papers3_epdiy_update_area(size_t n_args, const mp_obj_t *args) {
         .height = h
     };
     
+    papers3_epdiy_check_no_ink();
+
+    // 等待异步刷新完成
+    papers3_epdiy_async_wait();
+
     // 电源管理 + 区域更新
     epd_poweron();
     epd_hl_update_area(&self->hl, (enum EpdDrawMode)mode, self->temperature, area);
@@ -397,6 +679,9 @@ STATIC mp_obj_t papers3_epdiy_clear(mp_obj_t self_in) {
         mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
     }
     
+    papers3_epdiy_check_no_ink();
+    papers3_epdiy_async_wait();
+
     epd_poweron();
     epd_clear();
     epd_poweroff();
@@ -404,6 +689,268 @@ STATIC mp_obj_t papers3_epdiy_clear(mp_obj_t self_in) {
     return mp_const_none;
 }
 
+// 异步更新全屏：立即返回，刷新在后台任务中进行
+STATIC mp_obj_t papers3_epdiy_update_async(size_t n_args, const mp_obj_t *args) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    int mode = (n_args > 1) ? mp_obj_get_int(args[1]) : MODE_GC16;
+    EpdRefreshScheduler areas = epd_hl_scheduler_init(0, 0);
+    epd_hl_invalidate(&areas, epd_full_screen(), (enum EpdDrawMode)mode);
+    papers3_epdiy_async_start(self, &areas);
+    
+    return mp_const_none;
+}
+
+// 异步更新区域
+STATIC mp_obj_t papers3_epdiy_update_area_async(size_t n_args, const mp_obj_t *args) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    EpdRect area = {
+        .x = mp_obj_get_int(args[1]),
+        .y = mp_obj_get_int(args[2]),
+        .width = mp_obj_get_int(args[3]),
+        .height = mp_obj_get_int(args[4])
+    };
+    int mode = (n_args > 5) ? mp_obj_get_int(args[5]) : MODE_GC16;
+    EpdRefreshScheduler areas = epd_hl_scheduler_init(0, 0);
+    epd_hl_invalidate(&areas, area, (enum EpdDrawMode)mode);
+    papers3_epdiy_async_start(self, &areas);
+    
+    return mp_const_none;
+}
+
+// 查询异步刷新是否仍在进行 (uasyncio中可轮询: while epd.is_busy(): await asyncio.sleep_ms(10))
+STATIC mp_obj_t papers3_epdiy_is_busy(mp_obj_t self_in) {
+    return mp_obj_new_bool(async_update.busy);
+}
+
+// 等待异步刷新完成
+STATIC mp_obj_t papers3_epdiy_wait(mp_obj_t self_in) {
+    papers3_epdiy_async_wait();
+    return mp_const_none;
+}
+
+// 设置残影清除阈值：64x64区块的快速刷新(DU/A2等)次数达到该值后，
+// 在下一次批量刷新(invalidate/tick/flush)时对该区块做GC16刷新；0表示关闭
+STATIC mp_obj_t papers3_epdiy_set_ghosting_threshold(mp_obj_t self_in, mp_obj_t threshold_in) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    papers3_epdiy_async_wait();
+    epd_hl_set_ghosting_threshold(&self->hl, mp_obj_get_int(threshold_in));
+    
+    return mp_const_none;
+}
+
+// 开启电源会话：电源轨保持开启直到power_off()，连续刷新无需等待上电
+STATIC mp_obj_t papers3_epdiy_power_on(mp_obj_t self_in) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    papers3_epdiy_check_no_ink();
+
+    xSemaphoreTake(power_lock, portMAX_DELAY);
+    esp_timer_stop(power_idle_timer);
+    power_hold = true;
+    papers3_power_rails_on();
+    xSemaphoreGive(power_lock);
+    
+    return mp_const_none;
+}
+
+// 结束电源会话并立即关闭电源轨
+STATIC mp_obj_t papers3_epdiy_power_off(mp_obj_t self_in) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    papers3_epdiy_check_no_ink();
+    papers3_epdiy_async_wait();
+    
+    xSemaphoreTake(power_lock, portMAX_DELAY);
+    esp_timer_stop(power_idle_timer);
+    power_hold = false;
+    papers3_power_rails_off();
+    xSemaphoreGive(power_lock);
+    
+    return mp_const_none;
+}
+
+// 设置空闲超时(ms)，最后一次刷新后经过该时间关闭电源轨；-1表示不自动关闭
+STATIC mp_obj_t papers3_epdiy_set_power_timeout(mp_obj_t self_in, mp_obj_t timeout_in) {
+    power_idle_timeout_ms = mp_obj_get_int(timeout_in);
+    return mp_const_none;
+}
+
+// ===== 手写墨迹 =====
+// 笔画线段用A2波形和1bit数据只刷新涉及的行，会话期间面板保持上电
+
+// 开始墨迹会话：ink_end()之前的刷新和电源操作抛出RuntimeError，invalidate()的区域在之后刷新
+STATIC mp_obj_t papers3_epdiy_ink_begin(mp_obj_t self_in) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    if (ink_active) {
+        return mp_const_none;
+    }
+
+    papers3_epdiy_async_wait();
+    ink_session = epd_hl_ink_begin(&self->hl);
+    ink_active = true;
+
+    return mp_const_none;
+}
+
+// 添加一段笔画 (x0, y0, x1, y1[, width])，在下一次ink_flush()时显示
+STATIC mp_obj_t papers3_epdiy_ink_line(size_t n_args, const mp_obj_t *args) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+
+    if (!ink_active) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("Ink session not started"));
+    }
+
+    mp_int_t width = (n_args > 5) ? mp_obj_get_int(args[5]) : INK_DEFAULT_WIDTH;
+    if (width < 1 || width > 255) {
+        mp_raise_ValueError(MP_ERROR_TEXT("width must be 1 to 255"));
+    }
+
+    EpdInkSegment segment = {
+        .x0 = mp_obj_get_int(args[1]),
+        .y0 = mp_obj_get_int(args[2]),
+        .x1 = mp_obj_get_int(args[3]),
+        .y1 = mp_obj_get_int(args[4]),
+        .width = width,
+    };
+    // 队列已满时先刷新已有线段
+    if (!epd_hl_ink_add(&ink_session, segment)) {
+        epd_hl_ink_flush(&ink_session, self->temperature);
+        epd_hl_ink_add(&ink_session, segment);
+    }
+
+    return mp_const_none;
+}
+
+// 显示所有待处理的笔画线段
+STATIC mp_obj_t papers3_epdiy_ink_flush(mp_obj_t self_in) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (!ink_active) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("Ink session not started"));
+    }
+
+    epd_hl_ink_flush(&ink_session, self->temperature);
+
+    return mp_const_none;
+}
+
+// 显示剩余线段并结束墨迹会话
+STATIC mp_obj_t papers3_epdiy_ink_end(mp_obj_t self_in) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (ink_active) {
+        epd_hl_ink_flush(&ink_session, self->temperature);
+        epd_hl_ink_end(&ink_session);
+        ink_active = false;
+    }
+
+    return mp_const_none;
+}
+
+// 将调度器中待刷新的区域交给刷新任务
+static void papers3_epdiy_scheduler_start(papers3_epdiy_obj_t *self) {
+    EpdRefreshScheduler areas = epd_hl_scheduler_take(&refresh_scheduler);
+    if (areas.num_pending > 0) {
+        papers3_epdiy_async_start(self, &areas);
+    }
+}
+
+// 标记需要刷新的区域，到达刷新间隔且空闲时自动批量刷新
+STATIC mp_obj_t papers3_epdiy_invalidate(size_t n_args, const mp_obj_t *args) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    EpdRect area = {
+        .x = mp_obj_get_int(args[1]),
+        .y = mp_obj_get_int(args[2]),
+        .width = mp_obj_get_int(args[3]),
+        .height = mp_obj_get_int(args[4])
+    };
+    enum EpdDrawMode mode = (n_args > 5) ? mp_obj_get_int(args[5]) : MODE_GC16;
+    
+    // 调度器已满时先刷新已有区域
+    if (!epd_hl_invalidate(&refresh_scheduler, area, mode)) {
+        papers3_epdiy_scheduler_start(self);
+        epd_hl_invalidate(&refresh_scheduler, area, mode);
+    }
+    
+    // 墨迹会话期间推迟到ink_end()之后
+    if (!ink_active && !async_update.busy && epd_hl_scheduler_due(&refresh_scheduler)) {
+        papers3_epdiy_scheduler_start(self);
+    }
+    
+    return mp_const_none;
+}
+
+// 在主循环中调用：到达刷新间隔且空闲时刷新待处理区域
+STATIC mp_obj_t papers3_epdiy_tick(mp_obj_t self_in) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    if (!ink_active && !async_update.busy && epd_hl_scheduler_due(&refresh_scheduler)) {
+        papers3_epdiy_scheduler_start(self);
+    }
+    
+    return mp_obj_new_bool(async_update.busy);
+}
+
+// 立即刷新所有待处理区域并等待完成 (用于紧急更新)
+STATIC mp_obj_t papers3_epdiy_flush(mp_obj_t self_in) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    papers3_epdiy_check_no_ink();
+    papers3_epdiy_scheduler_start(self);
+    papers3_epdiy_async_wait();
+    
+    return mp_const_none;
+}
+
+// 设置批量刷新间隔(ms)和合并距离(像素)
+STATIC mp_obj_t papers3_epdiy_set_refresh_interval(size_t n_args, const mp_obj_t *args) {
+    refresh_scheduler.interval_ms = mp_obj_get_int(args[1]);
+    if (n_args > 2) {
+        refresh_scheduler.merge_distance = mp_obj_get_int(args[2]);
+    }
+    return mp_const_none;
+}
+
 // 获取显示尺寸
 STATIC mp_obj_t papers3_epdiy_get_width(mp_obj_t self_in) {
     return mp_obj_new_int(PAPERS3_WIDTH);
@@ -426,6 +973,53 @@ STATIC mp_obj_t papers3_epdiy_get_temperature(mp_obj_t self_in) {
     return mp_obj_new_int(self->temperature);
 }
 
+// ===== 性能统计 =====
+// 最近EPD_UPDATE_STATS_LEN次刷新的计数器，时间单位为微秒
+
+STATIC void stats_store_int(mp_obj_t dict, qstr key, mp_int_t value) {
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(key), mp_obj_new_int(value));
+}
+
+// 返回每次刷新的计数器字典列表，最新的在前
+STATIC mp_obj_t papers3_epdiy_stats(mp_obj_t self_in) {
+    EpdUpdateStats stats[EPD_UPDATE_STATS_LEN];
+    int count = epd_get_update_stats(stats, EPD_UPDATE_STATS_LEN);
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (int i = 0; i < count; i++) {
+        const EpdUpdateStats *s = &stats[i];
+        mp_obj_t dict = mp_obj_new_dict(14);
+        mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_time_us), mp_obj_new_int_from_ll(s->timestamp_us));
+        stats_store_int(dict, MP_QSTR_mode, s->mode & 0x3F);  // 不含打包方式等标志位
+        stats_store_int(dict, MP_QSTR_temperature, s->temperature);
+        stats_store_int(dict, MP_QSTR_diff_us, s->diff_us);
+        stats_store_int(dict, MP_QSTR_draw_us, s->draw_us);
+        stats_store_int(dict, MP_QSTR_frames, s->frames);
+        stats_store_int(dict, MP_QSTR_skipped_frames, s->skipped_frames);
+        stats_store_int(dict, MP_QSTR_feed_us, s->feed_us);
+        stats_store_int(dict, MP_QSTR_max_feed_us, s->max_feed_us);
+        stats_store_int(dict, MP_QSTR_isr_us, s->isr_us);
+        stats_store_int(dict, MP_QSTR_queue_stalls, s->queue_stalls);
+        stats_store_int(dict, MP_QSTR_underruns, s->underruns);
+        stats_store_int(dict, MP_QSTR_error, s->error);
+        mp_obj_t dirty[4] = {
+            mp_obj_new_int(s->dirty_area.x),
+            mp_obj_new_int(s->dirty_area.y),
+            mp_obj_new_int(s->dirty_area.width),
+            mp_obj_new_int(s->dirty_area.height),
+        };
+        mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(MP_QSTR_dirty), mp_obj_new_tuple(4, dirty));
+        mp_obj_list_append(list, dict);
+    }
+    return list;
+}
+
+// 清除统计
+STATIC mp_obj_t papers3_epdiy_reset_stats(mp_obj_t self_in) {
+    epd_reset_update_stats();
+    return mp_const_none;
+}
+
 // ===== 绘图功能 =====
 
 // 绘制像素点
@@ -540,6 +1134,33 @@ STATIC mp_obj_t papers3_epdiy_fill_rect(size_t n_args, const mp_obj_t *args) {
     return mp_const_none;
 }
 
+// 滚动区域内容 (x, y, width, height, dy)：dy为正向下、为负向上，按行整体搬移帧缓冲
+// 返回需要重绘的新露出条带 (x, y, width, height)；重绘后用DU/AUTO局部刷新即可，
+// 多次滚动积累的残影由残影清除阈值处理
+STATIC mp_obj_t papers3_epdiy_scroll(size_t n_args, const mp_obj_t *args) {
+    papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    
+    if (!self->initialized) {
+        mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("EPDiy not initialized"));
+    }
+    
+    EpdRect area = {
+        .x = mp_obj_get_int(args[1]),
+        .y = mp_obj_get_int(args[2]),
+        .width = mp_obj_get_int(args[3]),
+        .height = mp_obj_get_int(args[4])
+    };
+    EpdRect exposed = epd_hl_scroll(&self->hl, area, mp_obj_get_int(args[5]));
+    
+    mp_obj_t band[4] = {
+        mp_obj_new_int(exposed.x),
+        mp_obj_new_int(exposed.y),
+        mp_obj_new_int(exposed.width),
+        mp_obj_new_int(exposed.height),
+    };
+    return mp_obj_new_tuple(4, band);
+}
+
 // 绘制圆形轮廓
 STATIC mp_obj_t papers3_epdiy_draw_circle(size_t n_args, const mp_obj_t *args) {
     papers3_epdiy_obj_t *self = MP_OBJ_TO_PTR(args[0]);
@@ -753,23 +1374,42 @@ STATIC mp_obj_t papers3_epdiy_update(mp_obj_t self_in) {
 
 // ===== MicroPython 方法表和对象定义 =====
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_init_obj, papers3_epdiy_init);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_init_obj, 1, 4, papers3_epdiy_init);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_deinit_obj, papers3_epdiy_deinit);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_get_framebuffer_obj, papers3_epdiy_get_framebuffer);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_update_screen_obj, 1, 2, papers3_epdiy_update_screen);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_update_area_obj, 5, 6, papers3_epdiy_update_area);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_update_obj, papers3_epdiy_update);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_clear_obj, papers3_epdiy_clear);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_update_async_obj, 1, 2, papers3_epdiy_update_async);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_update_area_async_obj, 5, 6, papers3_epdiy_update_area_async);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_is_busy_obj, papers3_epdiy_is_busy);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_wait_obj, papers3_epdiy_wait);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_invalidate_obj, 5, 6, papers3_epdiy_invalidate);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_tick_obj, papers3_epdiy_tick);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_flush_obj, papers3_epdiy_flush);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_set_refresh_interval_obj, 2, 3, papers3_epdiy_set_refresh_interval);
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(papers3_epdiy_set_ghosting_threshold_obj, papers3_epdiy_set_ghosting_threshold);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_power_on_obj, papers3_epdiy_power_on);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_power_off_obj, papers3_epdiy_power_off);
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(papers3_epdiy_set_power_timeout_obj, papers3_epdiy_set_power_timeout);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_ink_begin_obj, papers3_epdiy_ink_begin);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_ink_line_obj, 5, 6, papers3_epdiy_ink_line);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_ink_flush_obj, papers3_epdiy_ink_flush);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_ink_end_obj, papers3_epdiy_ink_end);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_get_width_obj, papers3_epdiy_get_width);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_get_height_obj, papers3_epdiy_get_height);
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(papers3_epdiy_set_temperature_obj, papers3_epdiy_set_temperature);
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_get_temperature_obj, papers3_epdiy_get_temperature);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_stats_obj, papers3_epdiy_stats);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(papers3_epdiy_reset_stats_obj, papers3_epdiy_reset_stats);
 
 // 绘图函数定义
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_draw_pixel_obj, 4, 4, papers3_epdiy_draw_pixel);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_draw_line_obj, 6, 6, papers3_epdiy_draw_line);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_draw_rect_obj, 6, 6, papers3_epdiy_draw_rect);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_fill_rect_obj, 6, 6, papers3_epdiy_fill_rect);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_scroll_obj, 6, 6, papers3_epdiy_scroll);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_draw_circle_obj, 5, 5, papers3_epdiy_draw_circle);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_fill_circle_obj, 5, 5, papers3_epdiy_fill_circle);
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(papers3_epdiy_draw_triangle_obj, 8, 8, papers3_epdiy_draw_triangle);
@@ -789,6 +1429,30 @@ STATIC const mp_rom_map_elem_t papers3_epdiy_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&papers3_epdiy_update_obj) },
     { MP_ROM_QSTR(MP_QSTR_clear), MP_ROM_PTR(&papers3_epdiy_clear_obj) },
     
+    // 异步刷新
+    { MP_ROM_QSTR(MP_QSTR_update_async), MP_ROM_PTR(&papers3_epdiy_update_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_update_area_async), MP_ROM_PTR(&papers3_epdiy_update_area_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_is_busy), MP_ROM_PTR(&papers3_epdiy_is_busy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&papers3_epdiy_wait_obj) },
+    
+    // 刷新调度
+    { MP_ROM_QSTR(MP_QSTR_invalidate), MP_ROM_PTR(&papers3_epdiy_invalidate_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tick), MP_ROM_PTR(&papers3_epdiy_tick_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&papers3_epdiy_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_refresh_interval), MP_ROM_PTR(&papers3_epdiy_set_refresh_interval_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_ghosting_threshold), MP_ROM_PTR(&papers3_epdiy_set_ghosting_threshold_obj) },
+    
+    // 电源管理
+    { MP_ROM_QSTR(MP_QSTR_power_on), MP_ROM_PTR(&papers3_epdiy_power_on_obj) },
+    { MP_ROM_QSTR(MP_QSTR_power_off), MP_ROM_PTR(&papers3_epdiy_power_off_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_power_timeout), MP_ROM_PTR(&papers3_epdiy_set_power_timeout_obj) },
+
+    // 手写墨迹
+    { MP_ROM_QSTR(MP_QSTR_ink_begin), MP_ROM_PTR(&papers3_epdiy_ink_begin_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ink_line), MP_ROM_PTR(&papers3_epdiy_ink_line_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ink_flush), MP_ROM_PTR(&papers3_epdiy_ink_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ink_end), MP_ROM_PTR(&papers3_epdiy_ink_end_obj) },
+    
     // 属性访问
     { MP_ROM_QSTR(MP_QSTR_width), MP_ROM_PTR(&papers3_epdiy_get_width_obj) },
     { MP_ROM_QSTR(MP_QSTR_height), MP_ROM_PTR(&papers3_epdiy_get_height_obj) },
@@ -796,12 +1460,17 @@ STATIC const mp_rom_map_elem_t papers3_epdiy_locals_dict_table[] = {
     // 温度控制
     { MP_ROM_QSTR(MP_QSTR_set_temperature), MP_ROM_PTR(&papers3_epdiy_set_temperature_obj) },
     { MP_ROM_QSTR(MP_QSTR_get_temperature), MP_ROM_PTR(&papers3_epdiy_get_temperature_obj) },
+
+    // 性能统计
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&papers3_epdiy_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset_stats), MP_ROM_PTR(&papers3_epdiy_reset_stats_obj) },
     
     // 绘图函数
     { MP_ROM_QSTR(MP_QSTR_draw_pixel), MP_ROM_PTR(&papers3_epdiy_draw_pixel_obj) },
     { MP_ROM_QSTR(MP_QSTR_draw_line), MP_ROM_PTR(&papers3_epdiy_draw_line_obj) },
     { MP_ROM_QSTR(MP_QSTR_draw_rect), MP_ROM_PTR(&papers3_epdiy_draw_rect_obj) },
     { MP_ROM_QSTR(MP_QSTR_fill_rect), MP_ROM_PTR(&papers3_epdiy_fill_rect_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scroll), MP_ROM_PTR(&papers3_epdiy_scroll_obj) },
     { MP_ROM_QSTR(MP_QSTR_draw_circle), MP_ROM_PTR(&papers3_epdiy_draw_circle_obj) },
     { MP_ROM_QSTR(MP_QSTR_fill_circle), MP_ROM_PTR(&papers3_epdiy_fill_circle_obj) },
     { MP_ROM_QSTR(MP_QSTR_draw_triangle), MP_ROM_PTR(&papers3_epdiy_draw_triangle_obj) },
@@ -815,6 +1484,11 @@ STATIC const mp_rom_map_elem_t papers3_epdiy_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_MODE_GC16), MP_ROM_INT(MODE_GC16) },
     { MP_ROM_QSTR(MP_QSTR_MODE_GL16), MP_ROM_INT(MODE_GL16) },
     { MP_ROM_QSTR(MP_QSTR_MODE_A2), MP_ROM_INT(MODE_A2) },
+    { MP_ROM_QSTR(MP_QSTR_MODE_AUTO), MP_ROM_INT(MODE_AUTO) },
+    
+    // 常量 - LUT大小
+    { MP_ROM_QSTR(MP_QSTR_LUT_1K), MP_ROM_INT(EPD_LUT_1K) },
+    { MP_ROM_QSTR(MP_QSTR_LUT_64K), MP_ROM_INT(EPD_LUT_64K) },
 };
 STATIC MP_DEFINE_CONST_DICT(papers3_epdiy_locals_dict, papers3_epdiy_locals_dict_table);
 